@@ -24,6 +24,96 @@ ccv_sift_param_t* myccv_pack_parameters(int noctaves, int nlevels, int up2x, int
 	return res;
 }
 
+/* Image::CCV::Matrix objects keep the decoded matrix in $self->{matrix} */
+ccv_dense_matrix_t* myccv_matrix_from_object(SV* image)
+{
+	if (sv_isobject(image) && sv_derived_from(image, "Image::CCV::Matrix"))
+	{
+		SV** matrix = hv_fetchs((HV*)SvRV(image), "matrix", 0);
+		if (matrix && sv_derived_from(*matrix, "ccv_dense_matrix_tPtr"))
+			return INT2PTR(ccv_dense_matrix_t*, SvIV(SvRV(*matrix)));
+	}
+	return 0;
+}
+
+/* Decodes an image handed in from Perl into a grayscale matrix:
+     $matrix                        - an already decoded Image::CCV::Matrix
+     "file.png"                     - read from disk
+     \$jpeg_bytes                   - encoded PNG/JPEG/BMP file contents
+     { data => $pixels, width => ..., height => ...,
+       format => 'gray', scanline => ... } - raw pixels
+   With no_copy, raw gray pixels are used in place (CCV_IO_NO_COPY), so
+   the returned matrix must be released before the Perl scalar goes away.
+   Release the matrix through myccv_free_image(), which leaves matrices
+   owned by an Image::CCV::Matrix alone.
+   With max_dimension, images larger than that are shrunk to fit, JPEG
+   images partly while decoding already.
+   Returns 0 if the image could not be read */
+ccv_dense_matrix_t* myccv_read_image(SV* image, int no_copy, int max_dimension)
+{
+	ccv_dense_matrix_t* data = myccv_matrix_from_object(image);
+	if (data)
+		return data;
+	if (SvROK(image) && SvTYPE(SvRV(image)) == SVt_PVHV)
+	{
+		HV* raw = (HV*)SvRV(image);
+		SV** pixels = hv_fetchs(raw, "data", 0);
+		SV** width = hv_fetchs(raw, "width", 0);
+		SV** height = hv_fetchs(raw, "height", 0);
+		SV** format = hv_fetchs(raw, "format", 0);
+		SV** scanline = hv_fetchs(raw, "scanline", 0);
+		if (!pixels || !width || !height)
+			croak("Raw image needs 'data', 'width' and 'height'");
+		const char* fmt = format ? SvPV_nolen(*format) : "gray";
+		int type, channels;
+		if (strEQ(fmt, "gray"))
+			type = CCV_IO_GRAY_RAW | (no_copy ? CCV_IO_NO_COPY : CCV_IO_GRAY), channels = 1;
+		else if (strEQ(fmt, "rgb"))
+			type = CCV_IO_RGB_RAW | CCV_IO_GRAY, channels = 3;
+		else if (strEQ(fmt, "bgr"))
+			type = CCV_IO_BGR_RAW | CCV_IO_GRAY, channels = 3;
+		else if (strEQ(fmt, "rgba"))
+			type = CCV_IO_RGBA_RAW | CCV_IO_GRAY, channels = 4;
+		else if (strEQ(fmt, "bgra"))
+			type = CCV_IO_BGRA_RAW | CCV_IO_GRAY, channels = 4;
+		else if (strEQ(fmt, "argb"))
+			type = CCV_IO_ARGB_RAW | CCV_IO_GRAY, channels = 4;
+		else if (strEQ(fmt, "abgr"))
+			type = CCV_IO_ABGR_RAW | CCV_IO_GRAY, channels = 4;
+		else
+			croak("Unknown raw image format '%s'", fmt);
+		int cols = SvIV(*width);
+		int rows = SvIV(*height);
+		int step = scanline ? SvIV(*scanline) : cols * channels;
+		STRLEN len;
+		char* buf = SvPV(*pixels, len);
+		if (rows <= 0 || cols <= 0 || step < cols * channels || len < (STRLEN)rows * step)
+			croak("Raw image data does not match %dx%d %s", cols, rows, fmt);
+		ccv_read(buf, &data, type, rows, cols, step);
+	} else if (SvROK(image)) {
+		STRLEN len;
+		char* buf = SvPV(SvRV(image), len);
+		if (len > 8)
+			ccv_read(buf, &data, CCV_IO_GRAY | CCV_IO_ANY_STREAM, (int)len, max_dimension, max_dimension);
+	} else {
+		ccv_read(SvPV_nolen(image), &data, CCV_IO_GRAY | CCV_IO_ANY_FILE, max_dimension, max_dimension);
+	}
+	if (data && max_dimension > 0 && (data->rows > max_dimension || data->cols > max_dimension))
+	{
+		ccv_dense_matrix_t* resize = 0;
+		ccv_resample(data, &resize, 0, ccv_min(max_dimension, (int)(data->rows * (float)max_dimension / data->cols + 0.5)), ccv_min(max_dimension, (int)(data->cols * (float)max_dimension / data->rows + 0.5)), CCV_INTER_AREA);
+		ccv_matrix_free(data);
+		data = resize;
+	}
+	return data;
+}
+
+void myccv_free_image(SV* image, ccv_dense_matrix_t* data)
+{
+	if (data && !myccv_matrix_from_object(image))
+		ccv_matrix_free(data);
+}
+
 /* Should this just become a tiearray interface?! */
 void myccv_keypoints_to_list(ccv_array_t* keypoints)
 {
@@ -38,6 +128,7 @@ void myccv_keypoints_to_list(ccv_array_t* keypoints)
           
           av_push( point, newSVnv( kp->x ));
           av_push( point, newSVnv( kp->y ));
+          av_push( res, newRV_noinc((SV*) point));
       };
       
       Inline_Stack_Push(sv_2mortal(newRV_noinc((SV*) res)));
@@ -45,123 +136,181 @@ void myccv_keypoints_to_list(ccv_array_t* keypoints)
       return;
 }
 
-void myccv_get_descriptor(char* file, ccv_sift_param_t* param)
+void myccv_get_descriptor(SV* image, ccv_sift_param_t* param, int quantize)
 {
 	Inline_Stack_Vars;
 	Inline_Stack_Reset;
 
-	ccv_dense_matrix_t* data = 0;
-	ccv_read(file, &data, CCV_IO_GRAY | CCV_IO_ANY_FILE);
-	assert(data);
+	ccv_dense_matrix_t* data = myccv_read_image(image, 1, 0);
+	if (!data)
+		croak("Couldn't read image");
 	
 	ccv_array_t* keypoints = 0;
 	ccv_dense_matrix_t* descriptor = 0;
-	ccv_sift(data, &keypoints, &descriptor, 0, *param);
+	ccv_sift(data, &keypoints, &descriptor, quantize ? CCV_8U : 0, *param);
+	myccv_free_image(image, data);
 
-	/* TODO We should blesss those into proper classes for automatic deallocation */
-        Inline_Stack_Push(sv_2mortal(newSVpv((void *)descriptor,0)));
-	Inline_Stack_Push(sv_2mortal(newSVpv((void *)keypoints,0)));
+	/* The blessed pointers free the C structures in their DESTROY */
+	Inline_Stack_Push(sv_2mortal(sv_setref_pv(newSV(0), "ccv_array_tPtr", (void*)keypoints)));
+	Inline_Stack_Push(sv_2mortal(sv_setref_pv(newSV(0), "ccv_dense_matrix_tPtr", (void*)descriptor)));
 	
 	Inline_Stack_Done;
 	return;
 }
 
-void myccv_sift(char* object_file, char* scene_file, ccv_sift_param_t* param)
+void myccv_sift_read(char* filename)
+{
+	Inline_Stack_Vars;
+	Inline_Stack_Reset;
+
+	ccv_sift_file_t* file = ccv_sift_read(filename);
+	if (!file)
+		croak("Couldn't read SIFT features from '%s'", filename);
+
+	/* The key-points and descriptors point into the mapped file, only the file gets freed */
+	Inline_Stack_Push(sv_2mortal(sv_setref_pv(newSV(0), "ccv_sift_file_tPtr", (void*)file)));
+	Inline_Stack_Push(sv_2mortal(sv_setref_pv(newSV(0), "ccv_array_tView", (void*)&file->keypoints)));
+	Inline_Stack_Push(sv_2mortal(sv_setref_pv(newSV(0), "ccv_dense_matrix_tView", (void*)&file->desc)));
+
+	Inline_Stack_Done;
+	return;
+}
+
+/* Pushes one [object-x, object-y, scene-x, scene-y] arrayref per match */
+SV** myccv_push_matches(SV** sp, ccv_array_t* matches, ccv_array_t* obj_keypoints, ccv_array_t* scene_keypoints)
+{
+	int i;
+	for (i = 0; i < matches->rnum; i++)
+	{
+		ccv_sift_match_t* match = (ccv_sift_match_t*)ccv_array_get(matches, i);
+		ccv_keypoint_t* op = (ccv_keypoint_t*)ccv_array_get(obj_keypoints, match->object);
+		ccv_keypoint_t* kp = (ccv_keypoint_t*)ccv_array_get(scene_keypoints, match->scene);
+		// Create the new 4-item array
+		AV* res = newAV();
+		av_push( res, newSVnv( op->x ));
+		av_push( res, newSVnv( op->y ));
+		av_push( res, newSVnv( kp->x ));
+		av_push( res, newSVnv( kp->y ));
+		XPUSHs(sv_2mortal(newRV_noinc((SV*) res)));
+	}
+	return sp;
+}
+
+/* Checks what ccv_sift_match would assert */
+void myccv_check_match(ccv_dense_matrix_t* obj_desc, ccv_dense_matrix_t* scene_desc, int norm)
+{
+	int type = CCV_GET_DATA_TYPE(obj_desc->type);
+	if ((type != CCV_32F && type != CCV_8U) || obj_desc->cols != 128 || scene_desc->cols != 128)
+		croak("Not a SIFT descriptor");
+	if (CCV_GET_DATA_TYPE(scene_desc->type) != type)
+		croak("Can't match quantized and unquantized SIFT descriptors");
+	if (norm == CCV_L1_NORM && type != CCV_8U)
+		croak("L1 matching needs quantized SIFT descriptors");
+}
+
+void myccv_sift(SV* object_image, SV* scene_image, ccv_sift_param_t* param, int trees, int checks, double ratio, int quantize, int norm)
 {
         Inline_Stack_Vars;
         Inline_Stack_Reset;
 
-	ccv_enable_default_cache();
-	ccv_dense_matrix_t* object = 0;
-	ccv_dense_matrix_t* image = 0;
-	ccv_read(object_file, &object, CCV_IO_GRAY | CCV_IO_ANY_FILE);
-	assert(object);
-	ccv_read(scene_file, &image, CCV_IO_GRAY | CCV_IO_ANY_FILE);
-	assert(image);
+	if (norm == CCV_L1_NORM && !quantize)
+		croak("L1 matching needs quantized SIFT descriptors");
+	ccv_dense_matrix_t* object = myccv_read_image(object_image, 1, 0);
+	if (!object)
+		croak("Couldn't read object image");
+	ccv_dense_matrix_t* image = myccv_read_image(scene_image, 1, 0);
+	if (!image)
+	{
+		myccv_free_image(object_image, object);
+		croak("Couldn't read scene image");
+	}
 	ccv_array_t* obj_keypoints = 0;
 	ccv_dense_matrix_t* obj_desc = 0;
-	ccv_sift(object, &obj_keypoints, &obj_desc, 0, *param);
+	ccv_sift(object, &obj_keypoints, &obj_desc, quantize ? CCV_8U : 0, *param);
 	ccv_array_t* image_keypoints = 0;
 	ccv_dense_matrix_t* image_desc = 0;
-	ccv_sift(image, &image_keypoints, &image_desc, 0, *param);
-	int i, j, k;
-	int match = 0;
-	for (i = 0; i < obj_keypoints->rnum; i++)
-	{
-		float* odesc = obj_desc->data.f32 + i * 128;
-		int minj = -1;
-		double mind = 1e6, mind2 = 1e6;
-		for (j = 0; j < image_keypoints->rnum; j++)
-		{
-			float* idesc = image_desc->data.f32 + j * 128;
-			double d = 0;
-			for (k = 0; k < 128; k++)
-			{
-				d += (odesc[k] - idesc[k]) * (odesc[k] - idesc[k]);
-				if (d > mind2)
-					break;
-			}
-			if (d < mind)
-			{
-				mind2 = mind;
-				mind = d;
-				minj = j;
-			} else if (d < mind2) {
-				mind2 = d;
-			}
-		}
-		if (mind < mind2 * 0.36)
-		{
-			ccv_keypoint_t* op = (ccv_keypoint_t*)ccv_array_get(obj_keypoints, i);
-			ccv_keypoint_t* kp = (ccv_keypoint_t*)ccv_array_get(image_keypoints, minj);
-			// Create the new 4-item array
-			AV* res = newAV();
-			av_push( res, newSVnv( op->x ));
-			av_push( res, newSVnv( op->y ));
-			av_push( res, newSVnv( kp->x ));
-			av_push( res, newSVnv( kp->y ));
-                        Inline_Stack_Push(sv_2mortal(newRV_noinc((SV*) res)));
-			match++;
-		}
-	}
+	ccv_sift(image, &image_keypoints, &image_desc, quantize ? CCV_8U : 0, *param);
+	ccv_sift_match_param_t match_params = { .checks = checks, .ratio = ratio, .norm = norm };
+	/* the index only pays off if a query checks fewer descriptors than the scene has */
+	ccv_sift_index_t* index = 0;
+	if (trees > 0 && checks > 0 && checks < image_desc->rows)
+		index = ccv_sift_index_new(image_desc, trees);
+	ccv_array_t* matches = ccv_sift_match(obj_desc, image_desc, index, match_params);
+	sp = myccv_push_matches(sp, matches, obj_keypoints, image_keypoints);
+	ccv_array_free(matches);
+	if (index)
+		ccv_sift_index_free(index);
 	ccv_array_free(obj_keypoints);
 	ccv_array_free(image_keypoints);
 	ccv_matrix_free(obj_desc);
 	ccv_matrix_free(image_desc);
-	ccv_matrix_free(object);
-	ccv_matrix_free(image);
-	ccv_disable_cache();
+	myccv_free_image(object_image, object);
+	myccv_free_image(scene_image, image);
 	Inline_Stack_Done;
 	return;
 }
-// 3
 
-MODULE = Image::CCV	PACKAGE = Image::CCV	
+void myccv_sift_match(ccv_array_t* obj_keypoints, ccv_dense_matrix_t* obj_desc, ccv_array_t* scene_keypoints, ccv_dense_matrix_t* scene_desc, SV* index, int checks, double ratio, int norm)
+{
+	Inline_Stack_Vars;
+	Inline_Stack_Reset;
 
-PROTOTYPES: DISABLE
+	myccv_check_match(obj_desc, scene_desc, norm);
 
+	ccv_sift_index_t* scene_index = 0;
+	if (SvOK(index))
+	{
+		if (!sv_derived_from(index, "ccv_sift_index_tPtr"))
+			croak("index is not of type ccv_sift_index_tPtr");
+		scene_index = INT2PTR(ccv_sift_index_t*, SvIV(SvRV(index)));
+	}
+	ccv_sift_match_param_t match_params = { .checks = checks, .ratio = ratio, .norm = norm };
+	ccv_array_t* matches = ccv_sift_match(obj_desc, scene_desc, scene_index, match_params);
+	sp = myccv_push_matches(sp, matches, obj_keypoints, scene_keypoints);
+	ccv_array_free(matches);
+	Inline_Stack_Done;
+	return;
+}
 
-void
-myccv_detect_faces (filename, training_data)
-	char *	filename
-	char *	training_data
-	PREINIT:
-	I32* temp;
-	PPCODE:
-	temp = PL_markstack_ptr++;
+void myccv_bbf_read_classifier_cascade_file(char* filename)
+{
+	Inline_Stack_Vars;
+	Inline_Stack_Reset;
+
+	ccv_bbf_classifier_cascade_file_t* file = ccv_bbf_classifier_cascade_read_file(filename);
+	if (!file)
+		croak("Couldn't read BBF classifier cascade from '%s'", filename);
+
+	/* The cascade points into the mapped file, only the file gets freed */
+	Inline_Stack_Push(sv_2mortal(sv_setref_pv(newSV(0), "ccv_bbf_classifier_cascade_file_tPtr", (void*)file)));
+	Inline_Stack_Push(sv_2mortal(sv_setref_pv(newSV(0), "ccv_bbf_classifier_cascade_tView", (void*)&file->cascade)));
+
+	Inline_Stack_Done;
+	return;
+}
+
+ccv_detect_video_t* myccv_detect_video_new(int interval, double margin, double scale)
+{
+	ccv_detect_video_param_t params = { .interval = interval, .margin = margin, .scale = scale };
+	return ccv_detect_video_new(params);
+}
+
+/* video is undef, or a ccv_detect_video_tPtr that carries the detections
+   of the previous frame over to this one */
+void myccv_bbf_detect(SV* video, SV* scene, ccv_bbf_classifier_cascade_t* cascade, int interval, int min_neighbors, int accurate, int no_nested, int width, int height, int min_width, int min_height, int max_width, int max_height, int roi_x, int roi_y, int roi_width, int roi_height)
+{
 	Inline_Stack_Vars;
 	Inline_Stack_Reset;
 	int i;
-	ccv_enable_default_cache();
-	ccv_dense_matrix_t* image = 0;
-	/* TODO: Make the cascade accessible from the outside */
-	ccv_bbf_classifier_cascade_t* cascade = ccv_bbf_read_classifier_cascade(training_data);
-	ccv_read(filename, &image, CCV_IO_GRAY | CCV_IO_ANY_FILE);
+	ccv_dense_matrix_t* image = myccv_read_image(scene, 1, 0);
 	if (image != 0)
 	{
-		/* TODO: Make the BBF parameters accessible from the outside */
-		ccv_bbf_param_t params = { .interval = 5, .min_neighbors = 2, .accurate = 1, .flags = 0, .size = ccv_size(24, 24) };
-		ccv_array_t* seq = ccv_bbf_detect_objects(image, &cascade, 1, params);
+		ccv_bbf_param_t params = { .interval = interval, .min_neighbors = min_neighbors, .accurate = accurate, .flags = no_nested ? CCV_BBF_NO_NESTED : 0, .size = ccv_size(width, height), .min_size = ccv_size(min_width, min_height), .max_size = ccv_size(max_width, max_height), .roi = ccv_rect(roi_x, roi_y, roi_width, roi_height) };
+		ccv_array_t* seq;
+		if (SvOK(video) && sv_derived_from(video, "ccv_detect_video_tPtr"))
+			seq = ccv_bbf_detect_objects_in_video(INT2PTR(ccv_detect_video_t*, SvIV(SvRV(video))), image, &cascade, 1, params);
+		else
+			seq = ccv_bbf_detect_objects(image, &cascade, 1, params);
 		for (i = 0; i < seq->rnum; i++)
 		{
 			ccv_comp_t* comp = (ccv_comp_t*)ccv_array_get(seq, i);
@@ -172,21 +321,20 @@ myccv_detect_faces (filename, training_data)
 			av_push( res, newSVnv( comp->rect.width ));
 			av_push( res, newSVnv( comp->rect.height ));
 			av_push( res, newSVnv( comp->classification.confidence ));
-                        Inline_Stack_Push(sv_2mortal(newRV_noinc((SV*) res)));
+			Inline_Stack_Push(sv_2mortal(newRV_noinc((SV*) res)));
 		}
 		ccv_array_free(seq);
-		ccv_matrix_free(image);
+		myccv_free_image(scene, image);
 	}
-	ccv_bbf_classifier_cascade_free(cascade);
-	ccv_disable_cache();
 	Inline_Stack_Done;
-	if (PL_markstack_ptr != temp) {
-          /* truly void, because dXSARGS not invoked */
-	  PL_markstack_ptr = temp;
-	  XSRETURN_EMPTY; /* return empty stack */
-        }
-        /* must have used dXSARGS; list context implied */
-	return; /* assume stack size is correct */
+	return;
+}
+// 3
+
+MODULE = Image::CCV	PACKAGE = Image::CCV	
+
+PROTOTYPES: DISABLE
+
 
 ccv_sift_param_t *
 myccv_pack_parameters (noctaves, nlevels, up2x, edge_threshold, norm_threshold, peak_threshold)
@@ -214,14 +362,15 @@ myccv_keypoints_to_list (keypoints)
 	return; /* assume stack size is correct */
 
 void
-myccv_get_descriptor (file, param)
-	char *	file
+myccv_get_descriptor (image, param, quantize)
+	SV *	image
 	ccv_sift_param_t *	param
+	int	quantize
 	PREINIT:
 	I32* temp;
 	PPCODE:
 	temp = PL_markstack_ptr++;
-	myccv_get_descriptor(file, param);
+	myccv_get_descriptor(image, param, quantize);
 	if (PL_markstack_ptr != temp) {
           /* truly void, because dXSARGS not invoked */
 	  PL_markstack_ptr = temp;
@@ -231,15 +380,20 @@ myccv_get_descriptor (file, param)
 	return; /* assume stack size is correct */
 
 void
-myccv_sift (object_file, scene_file, param)
-	char *	object_file
-	char *	scene_file
+myccv_sift (object_image, scene_image, param, trees, checks, ratio, quantize, norm)
+	SV *	object_image
+	SV *	scene_image
 	ccv_sift_param_t *	param
+	int	trees
+	int	checks
+	double	ratio
+	int	quantize
+	int	norm
 	PREINIT:
 	I32* temp;
 	PPCODE:
 	temp = PL_markstack_ptr++;
-	myccv_sift(object_file, scene_file, param);
+	myccv_sift(object_image, scene_image, param, trees, checks, ratio, quantize, norm);
 	if (PL_markstack_ptr != temp) {
           /* truly void, because dXSARGS not invoked */
 	  PL_markstack_ptr = temp;
@@ -248,3 +402,281 @@ myccv_sift (object_file, scene_file, param)
         /* must have used dXSARGS; list context implied */
 	return; /* assume stack size is correct */
 
+int
+myccv_sift_write (keypoints, desc, filename)
+	ccv_array_t *	keypoints
+	ccv_dense_matrix_t *	desc
+	char *	filename
+	CODE:
+	RETVAL = ccv_sift_write(filename, keypoints, desc) == CCV_IO_FINAL;
+	OUTPUT:
+	RETVAL
+
+void
+myccv_sift_read (filename)
+	char *	filename
+	PREINIT:
+	I32* temp;
+	PPCODE:
+	temp = PL_markstack_ptr++;
+	myccv_sift_read(filename);
+	if (PL_markstack_ptr != temp) {
+          /* truly void, because dXSARGS not invoked */
+	  PL_markstack_ptr = temp;
+	  XSRETURN_EMPTY; /* return empty stack */
+        }
+        /* must have used dXSARGS; list context implied */
+	return; /* assume stack size is correct */
+
+ccv_sift_index_t *
+myccv_sift_index_new (desc, trees)
+	ccv_dense_matrix_t *	desc
+	int	trees
+	CODE:
+	RETVAL = ccv_sift_index_new(desc, trees);
+	OUTPUT:
+	RETVAL
+
+void
+myccv_sift_match (obj_keypoints, obj_desc, scene_keypoints, scene_desc, index, checks, ratio, norm)
+	ccv_array_t *	obj_keypoints
+	ccv_dense_matrix_t *	obj_desc
+	ccv_array_t *	scene_keypoints
+	ccv_dense_matrix_t *	scene_desc
+	SV *	index
+	int	checks
+	double	ratio
+	int	norm
+	PREINIT:
+	I32* temp;
+	PPCODE:
+	temp = PL_markstack_ptr++;
+	myccv_sift_match(obj_keypoints, obj_desc, scene_keypoints, scene_desc, index, checks, ratio, norm);
+	if (PL_markstack_ptr != temp) {
+          /* truly void, because dXSARGS not invoked */
+	  PL_markstack_ptr = temp;
+	  XSRETURN_EMPTY; /* return empty stack */
+        }
+        /* must have used dXSARGS; list context implied */
+	return; /* assume stack size is correct */
+
+ccv_bbf_classifier_cascade_t *
+myccv_bbf_read_classifier_cascade (directory)
+	char *	directory
+	CODE:
+	RETVAL = ccv_bbf_read_classifier_cascade(directory);
+	OUTPUT:
+	RETVAL
+
+void
+myccv_bbf_read_classifier_cascade_file (filename)
+	char *	filename
+	PREINIT:
+	I32* temp;
+	PPCODE:
+	temp = PL_markstack_ptr++;
+	myccv_bbf_read_classifier_cascade_file(filename);
+	if (PL_markstack_ptr != temp) {
+          /* truly void, because dXSARGS not invoked */
+	  PL_markstack_ptr = temp;
+	  XSRETURN_EMPTY; /* return empty stack */
+        }
+        /* must have used dXSARGS; list context implied */
+	return; /* assume stack size is correct */
+
+int
+myccv_bbf_write_classifier_cascade_file (cascade, filename)
+	ccv_bbf_classifier_cascade_t *	cascade
+	char *	filename
+	CODE:
+	RETVAL = ccv_bbf_classifier_cascade_write_file(cascade, filename) == CCV_IO_FINAL;
+	OUTPUT:
+	RETVAL
+
+void
+myccv_bbf_detect (video, scene, cascade, interval, min_neighbors, accurate, no_nested, width, height, min_width, min_height, max_width, max_height, roi_x, roi_y, roi_width, roi_height)
+	SV *	video
+	SV *	scene
+	ccv_bbf_classifier_cascade_t *	cascade
+	int	interval
+	int	min_neighbors
+	int	accurate
+	int	no_nested
+	int	width
+	int	height
+	int	min_width
+	int	min_height
+	int	max_width
+	int	max_height
+	int	roi_x
+	int	roi_y
+	int	roi_width
+	int	roi_height
+	PREINIT:
+	I32* temp;
+	PPCODE:
+	temp = PL_markstack_ptr++;
+	myccv_bbf_detect(video, scene, cascade, interval, min_neighbors, accurate, no_nested, width, height, min_width, min_height, max_width, max_height, roi_x, roi_y, roi_width, roi_height);
+	if (PL_markstack_ptr != temp) {
+          /* truly void, because dXSARGS not invoked */
+	  PL_markstack_ptr = temp;
+	  XSRETURN_EMPTY; /* return empty stack */
+        }
+        /* must have used dXSARGS; list context implied */
+	return; /* assume stack size is correct */
+
+ccv_detect_video_t *
+myccv_detect_video_new (interval, margin, scale)
+	int	interval
+	double	margin
+	double	scale
+
+ccv_dense_matrix_t *
+myccv_read_matrix (image, max_dimension)
+	SV *	image
+	int	max_dimension
+	CODE:
+	if (myccv_matrix_from_object(image))
+		croak("Image is already a decoded matrix");
+	RETVAL = myccv_read_image(image, 0, max_dimension);
+	OUTPUT:
+	RETVAL
+
+void
+myccv_matrix_dimensions (matrix)
+	ccv_dense_matrix_t *	matrix
+	PPCODE:
+	XPUSHs(sv_2mortal(newSViv(matrix->cols)));
+	XPUSHs(sv_2mortal(newSViv(matrix->rows)));
+
+ccv_dense_matrix_t *
+myccv_matrix_resample (matrix, rows, cols, type, btype)
+	ccv_dense_matrix_t *	matrix
+	int	rows
+	int	cols
+	int	type
+	int	btype
+	CODE:
+	if (rows <= 0 || cols <= 0)
+		croak("Can't resample to %d x %d", cols, rows);
+	RETVAL = 0;
+	ccv_resample(matrix, &RETVAL, btype, rows, cols, type);
+	OUTPUT:
+	RETVAL
+
+SV *
+myccv_matrix_data (matrix)
+	ccv_dense_matrix_t *	matrix
+	PREINIT:
+	int i;
+	size_t width;
+	CODE:
+	/* rows without the padding up to the matrix step */
+	width = matrix->cols * CCV_GET_CHANNEL(matrix->type) * CCV_GET_DATA_TYPE_SIZE(matrix->type);
+	RETVAL = newSV(width * matrix->rows + 1);
+	SvPOK_only(RETVAL);
+	for (i = 0; i < matrix->rows; i++)
+		sv_catpvn(RETVAL, (char*)matrix->data.u8 + matrix->step * i, width);
+	OUTPUT:
+	RETVAL
+
+int
+myccv_array_count (array)
+	ccv_array_t *	array
+	CODE:
+	RETVAL = array->rnum;
+	OUTPUT:
+	RETVAL
+
+void
+myccv_enable_cache (size)
+	UV	size
+	CODE:
+	ccv_enable_cache((size_t)size);
+
+void
+myccv_drain_cache ()
+	CODE:
+	ccv_drain_cache();
+
+void
+myccv_disable_cache ()
+	CODE:
+	ccv_disable_cache();
+
+void
+myccv_cache_stat ()
+	PREINIT:
+	ccv_cache_stat_t stat;
+	PPCODE:
+	stat = ccv_cache_stat();
+	XPUSHs(sv_2mortal(newSViv(stat.enabled)));
+	XPUSHs(sv_2mortal(newSVuv(stat.up)));
+	XPUSHs(sv_2mortal(newSVuv(stat.size)));
+	XPUSHs(sv_2mortal(newSVuv(stat.rnum)));
+	XPUSHs(sv_2mortal(newSVnv((NV)stat.hit)));
+	XPUSHs(sv_2mortal(newSVnv((NV)stat.miss)));
+
+MODULE = Image::CCV	PACKAGE = ccv_sift_param_tPtr
+
+void
+DESTROY (param)
+	ccv_sift_param_t *	param
+	CODE:
+	free(param);
+
+MODULE = Image::CCV	PACKAGE = ccv_dense_matrix_tPtr
+
+void
+DESTROY (matrix)
+	ccv_dense_matrix_t *	matrix
+	CODE:
+	ccv_matrix_free(matrix);
+
+MODULE = Image::CCV	PACKAGE = ccv_array_tPtr
+
+void
+DESTROY (array)
+	ccv_array_t *	array
+	CODE:
+	ccv_array_free(array);
+
+MODULE = Image::CCV	PACKAGE = ccv_sift_index_tPtr
+
+void
+DESTROY (index)
+	ccv_sift_index_t *	index
+	CODE:
+	ccv_sift_index_free(index);
+
+MODULE = Image::CCV	PACKAGE = ccv_sift_file_tPtr
+
+void
+DESTROY (file)
+	ccv_sift_file_t *	file
+	CODE:
+	ccv_sift_file_free(file);
+
+MODULE = Image::CCV	PACKAGE = ccv_bbf_classifier_cascade_tPtr
+
+void
+DESTROY (cascade)
+	ccv_bbf_classifier_cascade_t *	cascade
+	CODE:
+	ccv_bbf_classifier_cascade_free(cascade);
+
+MODULE = Image::CCV	PACKAGE = ccv_bbf_classifier_cascade_file_tPtr
+
+void
+DESTROY (file)
+	ccv_bbf_classifier_cascade_file_t *	file
+	CODE:
+	ccv_bbf_classifier_cascade_file_free(file);
+
+MODULE = Image::CCV	PACKAGE = ccv_detect_video_tPtr
+
+void
+DESTROY (video)
+	ccv_detect_video_t *	video
+	CODE:
+	ccv_detect_video_free(video);
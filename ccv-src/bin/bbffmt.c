@@ -98,7 +98,10 @@ void write_json(ccv_bbf_classifier_cascade_t* cascade)
 int main(int argc, char** argv)
 {
 	assert(argc >= 3);
-	ccv_bbf_classifier_cascade_t* cascade = ccv_bbf_read_classifier_cascade(argv[1]);
+	/* a cascade written in the "map" format can be converted again */
+	ccv_bbf_classifier_cascade_file_t* file = ccv_bbf_classifier_cascade_read_file(argv[1]);
+	ccv_bbf_classifier_cascade_t* cascade = file ? &file->cascade : ccv_bbf_read_classifier_cascade(argv[1]);
+	assert(cascade);
 	if (strcmp(argv[2], "bin") == 0)
 	{
 		assert(argc >= 4);
@@ -122,6 +125,17 @@ int main(int argc, char** argv)
 			printf("\\x%x", (unsigned char)s[i]);
 		fflush(NULL);
 		free(s);
+	} else if (strcmp(argv[2], "map") == 0) {
+		assert(argc >= 4);
+		if (ccv_bbf_classifier_cascade_write_file(cascade, argv[3]) != CCV_IO_FINAL)
+		{
+			fprintf(stderr, "cannot write %s\n", argv[3]);
+			return -1;
+		}
 	}
+	if (file)
+		ccv_bbf_classifier_cascade_file_free(file);
+	else
+		ccv_bbf_classifier_cascade_free(cascade);
 	return 0;
 }
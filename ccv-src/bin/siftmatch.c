@@ -32,43 +32,24 @@ int main(int argc, char** argv)
 	ccv_dense_matrix_t* image_desc = 0;
 	ccv_sift(image, &image_keypoints, &image_desc, 0, params);
 	elapsed_time = get_current_time() - elapsed_time;
-	int i, j, k;
-	int match = 0;
-	for (i = 0; i < obj_keypoints->rnum; i++)
+	/* the descriptors of a single image pair are too few to make building an index worthwhile */
+	ccv_sift_match_param_t match_params = {
+		.checks = 0,
+		.ratio = 0.6,
+	};
+	ccv_array_t* matches = ccv_sift_match(obj_desc, image_desc, 0, match_params);
+	int i;
+	for (i = 0; i < matches->rnum; i++)
 	{
-		float* odesc = obj_desc->data.f32 + i * 128;
-		int minj = -1;
-		double mind = 1e6, mind2 = 1e6;
-		for (j = 0; j < image_keypoints->rnum; j++)
-		{
-			float* idesc = image_desc->data.f32 + j * 128;
-			double d = 0;
-			for (k = 0; k < 128; k++)
-			{
-				d += (odesc[k] - idesc[k]) * (odesc[k] - idesc[k]);
-				if (d > mind2)
-					break;
-			}
-			if (d < mind)
-			{
-				mind2 = mind;
-				mind = d;
-				minj = j;
-			} else if (d < mind2) {
-				mind2 = d;
-			}
-		}
-		if (mind < mind2 * 0.36)
-		{
-			ccv_keypoint_t* op = (ccv_keypoint_t*)ccv_array_get(obj_keypoints, i);
-			ccv_keypoint_t* kp = (ccv_keypoint_t*)ccv_array_get(image_keypoints, minj);
-			printf("%f %f => %f %f\n", op->x, op->y, kp->x, kp->y);
-			match++;
-		}
+		ccv_sift_match_t* match = (ccv_sift_match_t*)ccv_array_get(matches, i);
+		ccv_keypoint_t* op = (ccv_keypoint_t*)ccv_array_get(obj_keypoints, match->object);
+		ccv_keypoint_t* kp = (ccv_keypoint_t*)ccv_array_get(image_keypoints, match->scene);
+		printf("%f %f => %f %f\n", op->x, op->y, kp->x, kp->y);
 	}
 	printf("%dx%d on %dx%d\n", object->cols, object->rows, image->cols, image->rows);
-	printf("%d keypoints out of %d are matched\n", match, obj_keypoints->rnum);
+	printf("%d keypoints out of %d are matched\n", matches->rnum, obj_keypoints->rnum);
 	printf("elpased time : %d\n", elapsed_time);
+	ccv_array_free(matches);
 	ccv_array_free(obj_keypoints);
 	ccv_array_free(image_keypoints);
 	ccv_matrix_free(obj_desc);
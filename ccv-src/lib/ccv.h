@@ -455,6 +455,21 @@ void ccv_enable_default_cache(void);
  */
 void ccv_enable_cache(size_t size);
 
+typedef struct {
+	int enabled; /**< Whether the application-wide cache is enabled for the current thread. */
+	size_t up; /**< The upper limit of the cache, in bytes. */
+	size_t size; /**< The memory currently held by cached objects, in bytes. */
+	uint32_t rnum; /**< The number of cached objects. */
+	uint64_t hit; /**< The number of matrices / arrays recycled from the cache. */
+	uint64_t miss; /**< The number of signed matrices / arrays that had to be computed anew. */
+} ccv_cache_stat_t;
+
+/**
+ * Report the state of the application-wide cache of the current thread.
+ * @return A **ccv_cache_stat_t** structure, hit / miss counters keep counting across enable / disable.
+ */
+ccv_cache_stat_t ccv_cache_stat(void);
+
 #define ccv_get_dense_matrix_cell_by(type, x, row, col, ch) \
 	(((type) & CCV_32S) ? (void*)((x)->data.i32 + ((row) * (x)->cols + (col)) * CCV_GET_CHANNEL(type) + (ch)) : \
 	(((type) & CCV_32F) ? (void*)((x)->data.f32+ ((row) * (x)->cols + (col)) * CCV_GET_CHANNEL(type) + (ch)) : \
@@ -557,6 +572,25 @@ enum {
  * @param type CCV_IO_ANY_STREAM, accept any file format. CCV_IO_GRAY, convert to grayscale image. CCV_IO_RGB_COLOR, convert to color image.
  * @param size The size of that data memory region.
  */
+/**
+ * @fn int ccv_read(const char* in, ccv_dense_matrix_t** x, int type, int rows, int cols)
+ * Read image from a file that is going to be shrunk to fit into rows x cols anyway. JPEG images are scaled down by 1/2, 1/4 or 1/8 while decoding, as far as they still reach the rows or the cols of that box. Other formats are read in full.
+ * @param in The file name.
+ * @param x The output image.
+ * @param type CCV_IO_ANY_FILE, accept any file format. CCV_IO_GRAY, convert to grayscale image. CCV_IO_RGB_COLOR, convert to color image.
+ * @param rows The height of the box, 0 to leave it open.
+ * @param cols The width of the box, 0 to leave it open.
+ */
+/**
+ * @fn int ccv_read(const void* data, ccv_dense_matrix_t** x, int type, int size, int rows, int cols)
+ * Read image from a region of memory like the above, for an image that is going to be shrunk to fit into rows x cols anyway.
+ * @param data The data memory.
+ * @param x The output image.
+ * @param type CCV_IO_ANY_STREAM, accept any file format. CCV_IO_GRAY, convert to grayscale image. CCV_IO_RGB_COLOR, convert to color image.
+ * @param size The size of that data memory region.
+ * @param rows The height of the box, 0 to leave it open.
+ * @param cols The width of the box, 0 to leave it open.
+ */
 /**
  * @fn int ccv_read(const void* data, ccv_dense_matrix_t** x, int type, int rows, int cols, int scanline)
  * Read image from a region of memory that assumes specific layout (RGB, GRAY, BGR, RGBA, ARGB, RGBA, ABGR, BGRA). By default, this method will create a matrix and copy data over to that matrix. With CCV_IO_NO_COPY, it will create a matrix that has data block pointing to the original data memory region. It is your responsibility to release that data memory at an appropriate time after release the matrix.
@@ -934,6 +968,19 @@ typedef int(*ccv_array_group_f)(const void*, const void*, void*);
  * @param data Any extra user data.
  */
 int ccv_array_group(ccv_array_t* array, ccv_array_t** index, ccv_array_group_f gfunc, void* data);
+typedef int(*ccv_array_bound_f)(const void*, ccv_rect_t*, void*);
+/**
+ * Group elements in the array from their similarity, with the same result as ccv_array_group, but only test elements
+ * whose bounding boxes overlap. The boxes are hashed into a grid per power-of-two size, so grouping takes close to
+ * linear time as long as each element overlaps only a few others that are not already in its group.
+ * @param array The array.
+ * @param index The output index, same group element will have the same index.
+ * @param gfunc int ccv_array_group_f(const void* a, const void* b, void* data). Return 1 if a and b are in the same group.
+ * @param bfunc int ccv_array_bound_f(const void* a, ccv_rect_t* bound, void* data). Fill the bounding box of a and return 1, or return 0 if a cannot be bounded and has to be tested against every other element. Whenever gfunc(a, b, data) returns 1, the boxes of a and b must overlap or touch.
+ * @param data Any extra user data.
+ * @return The number of groups.
+ */
+int ccv_array_group_bounded(ccv_array_t* array, ccv_array_t** index, ccv_array_group_f gfunc, ccv_array_bound_f bfunc, void* data);
 void ccv_make_array_immutable(ccv_array_t* array);
 void ccv_make_array_mutable(ccv_array_t* array);
 /**
@@ -1239,6 +1286,59 @@ void ccv_sample_down(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, in
  * @param src_y Shift the start point by src_y.
  */
 void ccv_sample_up(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, int src_x, int src_y);
+
+typedef struct {
+	ccv_dense_matrix_t* a; /**< The input image, it is not owned by the pyramid. */
+	int retain; /**< Keep the images that were released until the pyramid is freed, so other detectors can use them. On by default, with it off, an image is freed once everyone who got it released it. */
+	ccv_array_t* levels; /**< The images computed so far. */
+} ccv_pyramid_t;
+
+/**
+ * Create an image pyramid that computes its levels the first time they are asked for. Detectors that take a pyramid build theirs from it, so several detectors on the same image share the images they have in common.
+ * @param a The input image, it has to stay around until the pyramid is freed.
+ * @return A pyramid without any level computed, that retains its images.
+ */
+CCV_WARN_UNUSED(ccv_pyramid_t*) ccv_pyramid_new(ccv_dense_matrix_t* a);
+/**
+ * The **ccv_resample** of an image of the pyramid, computed once. It is safe to call from parallel_for.
+ * @param pyramid The pyramid.
+ * @param a The input image of the pyramid, or an image this pyramid returned.
+ * @param rows The new row.
+ * @param cols The new column.
+ * @param type CCV_INTER_AREA or CCV_INTER_CUBIC, see **ccv_resample**.
+ * @return The resampled image, it belongs to the pyramid and must not be freed.
+ */
+ccv_dense_matrix_t* ccv_pyramid_resample(ccv_pyramid_t* pyramid, ccv_dense_matrix_t* a, int rows, int cols, int type);
+/**
+ * The **ccv_sample_down** of an image of the pyramid, computed once. It is safe to call from parallel_for.
+ * @param pyramid The pyramid.
+ * @param a The input image of the pyramid, or an image this pyramid returned.
+ * @param src_x Shift the start point by src_x.
+ * @param src_y Shift the start point by src_y.
+ * @return The half size image, it belongs to the pyramid and must not be freed.
+ */
+ccv_dense_matrix_t* ccv_pyramid_sample_down(ccv_pyramid_t* pyramid, ccv_dense_matrix_t* a, int src_x, int src_y);
+/**
+ * The pyramid of a part of the input image, made once for each part, so detectors with the same region of interest share it. It is safe to call from parallel_for.
+ * @param pyramid The pyramid.
+ * @param x The left of the part.
+ * @param y The top of the part.
+ * @param rows The rows of the part.
+ * @param cols The columns of the part.
+ * @return The pyramid of the part, it retains its images if this pyramid does. It belongs to this pyramid, and is given back by releasing its input image with **ccv_pyramid_release**.
+ */
+ccv_pyramid_t* ccv_pyramid_slice(ccv_pyramid_t* pyramid, int x, int y, int rows, int cols);
+/**
+ * Done with an image the pyramid returned. It stays in a pyramid that retains its images, otherwise it is freed once every caller that got it released it. Releasing the input image does nothing.
+ * @param pyramid The pyramid.
+ * @param b The image, it must not be used after it is released.
+ */
+void ccv_pyramid_release(ccv_pyramid_t* pyramid, ccv_dense_matrix_t* b);
+/**
+ * Free every image computed by the pyramid, and the pyramid itself. The input image is left alone.
+ * @param pyramid The pyramid.
+ */
+void ccv_pyramid_free(ccv_pyramid_t* pyramid);
 /** @} */
 
 /**
@@ -1399,10 +1499,88 @@ extern const ccv_sift_param_t ccv_sift_default_params;
  * @param a The input matrix.
  * @param keypoints The array of key-points, a ccv_keypoint_t structure.
  * @param desc The descriptor for each key-point.
- * @param type The type of the descriptor, if 0, ccv will default to CCV_32F.
+ * @param type The type of the descriptor, if 0, ccv will default to CCV_32F. CCV_8U quantizes each descriptor to 128 bytes.
  * @param params A **ccv_sift_param_t** structure that defines various aspect of SIFT function.
  */
 void ccv_sift(ccv_dense_matrix_t* a, ccv_array_t** keypoints, ccv_dense_matrix_t** desc, int type, ccv_sift_param_t params);
+
+typedef struct {
+	int dim; /**< The split dimension, -1 for a leaf. */
+	float value; /**< The split value. */
+	int left; /**< The child node below the split value, or the first index of a leaf. */
+	int right; /**< The child node at / above the split value, or one past the last index of a leaf. */
+} ccv_sift_kd_node_t;
+
+typedef struct {
+	int trees; /**< Number of randomized kd-trees. */
+	int rnum; /**< Number of indexed descriptors. */
+	int* root; /**< The root node of each tree. */
+	int* idx; /**< The descriptor order of each tree, leaves refer to ranges of it. */
+	ccv_array_t* nodes; /**< The nodes of all trees, **ccv_sift_kd_node_t**. */
+} ccv_sift_index_t;
+
+typedef struct {
+	int checks; /**< The maximum number of descriptors compared per query. More checks find more true nearest neighbors at the cost of speed. 0 searches exhaustively. */
+	double ratio; /**< A match is only accepted if its distance is below ratio times the distance to the second nearest neighbor. */
+	int norm; /**< CCV_L1_NORM compares CCV_8U descriptors by the sum of absolute differences, otherwise descriptors are compared by the squared L2 distance. */
+} ccv_sift_match_param_t;
+
+typedef struct {
+	int object; /**< The index of the key-point in the object. */
+	int scene; /**< The index of the matching key-point in the scene. */
+	float distance; /**< The distance between both descriptors, see **ccv_sift_match_param_t**. */
+} ccv_sift_match_t;
+
+extern const ccv_sift_match_param_t ccv_sift_match_default_params;
+
+/**
+ * Build a randomized kd-forest over SIFT descriptors for approximate nearest neighbor search. The index refers to the descriptors, keep them around as long as the index.
+ * @param desc The descriptors, as computed by **ccv_sift**.
+ * @param trees The number of randomized kd-trees, 4 to 8 is a good choice.
+ * @return The index.
+ */
+CCV_WARN_UNUSED(ccv_sift_index_t*) ccv_sift_index_new(ccv_dense_matrix_t* desc, int trees);
+/**
+ * Free up the memory of a SIFT descriptor index.
+ * @param index The index.
+ */
+void ccv_sift_index_free(ccv_sift_index_t* index);
+/**
+ * Match each object descriptor to its nearest scene descriptor, and keep the matches passing the ratio test.
+ * @param a The object descriptors, CCV_32F or CCV_8U.
+ * @param b The scene descriptors, of the same type as **a**.
+ * @param index An index built over **b** with **ccv_sift_index_new**, or 0 to compare against every scene descriptor. The index is ignored if it wouldn't save any work.
+ * @param params A **ccv_sift_match_param_t** structure that defines the search.
+ * @return A **ccv_array_t** of **ccv_sift_match_t**.
+ */
+CCV_WARN_UNUSED(ccv_array_t*) ccv_sift_match(ccv_dense_matrix_t* a, ccv_dense_matrix_t* b, ccv_sift_index_t* index, ccv_sift_match_param_t params);
+
+typedef struct {
+	ccv_array_t keypoints; /**< The key-points, **ccv_keypoint_t**, pointing into the file. */
+	ccv_dense_matrix_t desc; /**< The descriptors, pointing into the file. */
+	void* map; /**< The file content. */
+	size_t size; /**< The size of the file content. */
+} ccv_sift_file_t;
+
+/**
+ * Write SIFT key-points and their descriptors to a file that **ccv_sift_read** maps back into memory. The file uses the byte order and key-point layout of the machine that writes it.
+ * @param filename The file name.
+ * @param keypoints The key-points from **ccv_sift**.
+ * @param desc The descriptors from **ccv_sift**.
+ * @return CCV_IO_FINAL on success, CCV_IO_ERROR if the file cannot be written.
+ */
+int ccv_sift_write(const char* filename, ccv_array_t* keypoints, ccv_dense_matrix_t* desc);
+/**
+ * Map a file written by **ccv_sift_write** into memory. The key-points and descriptors can be passed to **ccv_sift_match** and **ccv_sift_index_new** as is, nothing gets copied.
+ * @param filename The file name.
+ * @return The mapped file, or 0 if it cannot be read or was written by an incompatible machine.
+ */
+CCV_WARN_UNUSED(ccv_sift_file_t*) ccv_sift_read(const char* filename);
+/**
+ * Unmap a file read by **ccv_sift_read**. Neither its key-points nor its descriptors can be used afterwards.
+ * @param file The mapped file.
+ */
+void ccv_sift_file_free(ccv_sift_file_t* file);
 /** @} */
 
 /* mser related method */
@@ -1625,6 +1803,15 @@ void ccv_dpm_mixture_model_new(char** posfiles, ccv_rect_t* bboxes, int posnum,
  * @return A **ccv_array_t** of **ccv_root_comp_t** that contains the root bounding box as well as its parts.
  */
 CCV_WARN_UNUSED(ccv_array_t*) ccv_dpm_detect_objects(ccv_dense_matrix_t* a, ccv_dpm_mixture_model_t** model, int count, ccv_dpm_param_t params);
+/**
+ * The same as **ccv_dpm_detect_objects**, with the image pyramid taken from, and left in, a shared **ccv_pyramid_t**.
+ * @param pyramid The pyramid of the input image.
+ * @param model An array of mixture models.
+ * @param count How many mixture models you've passed in.
+ * @param params A **ccv_dpm_param_t** structure that defines various aspects of the detector.
+ * @return A **ccv_array_t** of **ccv_root_comp_t** that contains the root bounding box as well as its parts.
+ */
+CCV_WARN_UNUSED(ccv_array_t*) ccv_dpm_detect_objects_in_pyramid(ccv_pyramid_t* pyramid, ccv_dpm_mixture_model_t** model, int count, ccv_dpm_param_t params);
 /**
  * Read DPM mixture model from a model file.
  * @param directory The model file for DPM mixture model.
@@ -1638,6 +1825,63 @@ CCV_WARN_UNUSED(ccv_dpm_mixture_model_t*) ccv_dpm_read_mixture_model(const char*
 void ccv_dpm_mixture_model_free(ccv_dpm_mixture_model_t* model);
 /** @} */
 
+/**
+ * @defgroup ccv_detect_video object detection in video
+ * Consecutive video frames mostly show the same objects at about the same places and sizes. A detector that keeps a
+ * **ccv_detect_video_t** around scans the whole frame only every few frames, and in between only the neighbourhood of
+ * the objects it found in the previous frame, at scales close to theirs. Objects that newly enter the frame are found
+ * at the next full scan.
+ * @{
+ */
+
+typedef struct {
+	int interval; /**< Scan the whole frame every **interval** frames, 1 scans every frame in full. At least 1. */
+	float margin; /**< How far around an object of the previous frame to look, as a fraction of its width and height. Not negative. */
+	float scale; /**< How much larger or smaller than in the previous frame an object can get. At least 1. */
+} ccv_detect_video_param_t;
+
+typedef struct {
+	ccv_rect_t roi; /**< The region to scan. */
+	ccv_size_t min_size; /**< The smallest object size to look for. */
+	ccv_size_t max_size; /**< The largest object size to look for. */
+} ccv_detect_video_region_t;
+
+typedef struct {
+	ccv_detect_video_param_t params;
+	int frame; /**< The number of frames seen so far. */
+	ccv_array_t* seq; /**< A **ccv_array_t** of **ccv_comp_t** found in the previous frame. */
+} ccv_detect_video_t;
+
+extern const ccv_detect_video_param_t ccv_detect_video_default_params;
+
+/**
+ * Create a new context for detecting objects in consecutive frames of a video.
+ * @param params A **ccv_detect_video_param_t** structure that defines how often and how widely to scan. The interval and scale have to be at least 1, the margin must not be negative.
+ * @return The new context.
+ */
+CCV_WARN_UNUSED(ccv_detect_video_t*) ccv_detect_video_new(ccv_detect_video_param_t params);
+/**
+ * Plan the scan of the next frame. Detectors call this before, and **ccv_detect_video_update** after scanning a frame.
+ * @param video The context.
+ * @param roi The part of the frame the detector looks at.
+ * @param min_size The smallest object size the detector was asked for, 0 for no limit.
+ * @param max_size The largest object size the detector was asked for, 0 for no limit.
+ * @return 0 to scan the whole frame, or a **ccv_array_t** of non-overlapping **ccv_detect_video_region_t** to scan instead.
+ */
+CCV_WARN_UNUSED(ccv_array_t*) ccv_detect_video_regions(ccv_detect_video_t* video, ccv_rect_t roi, ccv_size_t min_size, ccv_size_t max_size);
+/**
+ * Remember the objects found in a frame, the next frame is scanned around them.
+ * @param video The context.
+ * @param seq A **ccv_array_t** of **ccv_comp_t**, it is copied.
+ */
+void ccv_detect_video_update(ccv_detect_video_t* video, ccv_array_t* seq);
+/**
+ * Free up the context.
+ * @param video The context.
+ */
+void ccv_detect_video_free(ccv_detect_video_t* video);
+/** @} */
+
 /**
  * @defgroup ccv_bbf binary brightness feature
  * this is open source implementation of object detection algorithm: brightness binary feature
@@ -1684,6 +1928,9 @@ typedef struct {
 	int flags; /**< CCV_BBF_NO_NESTED, if one class of object is inside another class of object, this flag will reject the first object. */
 	int accurate; /**< BBF will generates 4 spatial scale variations for better accuracy. Set this parameter to 0 will reduce to 1 scale variation, and thus 3 times faster but lower the general accuracy of the detector. */
 	ccv_size_t size; /**< The smallest object size that will be interesting to us. */
+	ccv_size_t min_size; /**< Scales that only find objects smaller than this are skipped. 0 to start from **size**. */
+	ccv_size_t max_size; /**< Scales that only find objects larger than this are skipped and their images never computed. 0 for no limit. */
+	ccv_rect_t roi; /**< Only find objects inside this region of the image, the whole image if its width or height is 0. */
 } ccv_bbf_param_t;
 
 typedef struct {
@@ -1723,6 +1970,25 @@ void ccv_bbf_classifier_cascade_new(ccv_dense_matrix_t** posimg, int posnum, cha
  * @return A **ccv_array_t** of **ccv_comp_t** for detection results.
  */
 CCV_WARN_UNUSED(ccv_array_t*) ccv_bbf_detect_objects(ccv_dense_matrix_t* a, ccv_bbf_classifier_cascade_t** cascade, int count, ccv_bbf_param_t params);
+/**
+ * The same as **ccv_bbf_detect_objects**, with the image pyramid taken from, and left in, a shared **ccv_pyramid_t**. A region of interest in params is searched in the **ccv_pyramid_slice** of the pyramid.
+ * @param pyramid The pyramid of the input image.
+ * @param cascade An array of classifier cascades.
+ * @param count How many classifier cascades you've passed in.
+ * @param params A **ccv_bbf_param_t** structure that defines various aspects of the detector.
+ * @return A **ccv_array_t** of **ccv_comp_t** for detection results.
+ */
+CCV_WARN_UNUSED(ccv_array_t*) ccv_bbf_detect_objects_in_pyramid(ccv_pyramid_t* pyramid, ccv_bbf_classifier_cascade_t** cascade, int count, ccv_bbf_param_t params);
+/**
+ * The same as **ccv_bbf_detect_objects** for one frame of a video. Only every few frames are scanned in full, see **ccv_detect_video_t**.
+ * @param video The context of the video, created by **ccv_detect_video_new**.
+ * @param a The frame.
+ * @param cascade An array of classifier cascades.
+ * @param count How many classifier cascades you've passed in.
+ * @param params A **ccv_bbf_param_t** structure that defines various aspects of the detector.
+ * @return A **ccv_array_t** of **ccv_comp_t** for detection results.
+ */
+CCV_WARN_UNUSED(ccv_array_t*) ccv_bbf_detect_objects_in_video(ccv_detect_video_t* video, ccv_dense_matrix_t* a, ccv_bbf_classifier_cascade_t** cascade, int count, ccv_bbf_param_t params);
 /**
  * Read BBF classifier cascade from working directory.
  * @param directory The working directory that trains a BBF classifier cascade.
@@ -1748,6 +2014,31 @@ CCV_WARN_UNUSED(ccv_bbf_classifier_cascade_t*) ccv_bbf_classifier_cascade_read_b
  * @return The actual size of the binarized BBF classifier cascade, if this size is larger than **slen**, please reallocate the memory region and do it again.
  */
 int ccv_bbf_classifier_cascade_write_binary(ccv_bbf_classifier_cascade_t* cascade, char* s, int slen);
+
+typedef struct {
+	ccv_bbf_classifier_cascade_t cascade; /**< The classifier cascade, its features and alphas point into the file. */
+	void* map; /**< The file content. */
+	size_t size; /**< The size of the file content. */
+} ccv_bbf_classifier_cascade_file_t;
+
+/**
+ * Write BBF classifier cascade to a file that **ccv_bbf_classifier_cascade_read_file** maps back into memory. The file uses the byte order and feature layout of the machine that writes it.
+ * @param cascade The BBF classifier cascade.
+ * @param filename The file name.
+ * @return CCV_IO_FINAL on success, CCV_IO_ERROR if the file cannot be written.
+ */
+int ccv_bbf_classifier_cascade_write_file(ccv_bbf_classifier_cascade_t* cascade, const char* filename);
+/**
+ * Map a file written by **ccv_bbf_classifier_cascade_write_file** into memory. The cascade uses the mapped features and alphas in place, so processes that map the same file share its pages.
+ * @param filename The file name.
+ * @return The mapped file, or 0 if it cannot be read or was written by an incompatible machine.
+ */
+CCV_WARN_UNUSED(ccv_bbf_classifier_cascade_file_t*) ccv_bbf_classifier_cascade_read_file(const char* filename);
+/**
+ * Unmap a file read by **ccv_bbf_classifier_cascade_read_file**. Its cascade cannot be used afterwards, and must not be passed to **ccv_bbf_classifier_cascade_free**.
+ * @param file The mapped file.
+ */
+void ccv_bbf_classifier_cascade_file_free(ccv_bbf_classifier_cascade_file_t* file);
 /** @} */
 
 /* Ferns classifier: this is a fern implementation that specifically used for TLD
@@ -1957,12 +2248,19 @@ typedef struct {
 
 typedef struct {
 	int min_neighbors; /**< 0: no grouping afterwards. 1: group objects that intersects each other. > 1: group objects that intersects each other, and only passes these that have at least **min_neighbors** intersected objects. */
-	int flags;
+	int flags; /**< CCV_ICF_APPROXIMATE_PYRAMID, compute the channel features exactly only once per octave, and extrapolate them for the interval images in between. Faster, at a slightly lower accuracy. Only for single scale classifier cascades. */
 	int step_through; /**< The step size for detection. */
 	int interval; /**< Interval images between the full size image and the half size one. e.g. 2 will generate 2 images in between full size image and half size one: image with full size, image with 5/6 size, image with 2/3 size, image with 1/2 size. */
 	float threshold;
+	ccv_size_t min_size; /**< Scales that only find objects smaller than this are skipped. 0 for no limit. */
+	ccv_size_t max_size; /**< Scales that only find objects larger than this are skipped and their images never computed. 0 for no limit. */
+	ccv_rect_t roi; /**< Only find objects inside this region of the image, the whole image if its width or height is 0. */
 } ccv_icf_param_t;
 
+enum {
+	CCV_ICF_APPROXIMATE_PYRAMID = 0x01,
+};
+
 extern const ccv_icf_param_t ccv_icf_default_params;
 
 typedef struct {
@@ -2036,6 +2334,15 @@ void ccv_icf_multiscale_classifier_cascade_free(ccv_icf_multiscale_classifier_ca
  * @return A **ccv_array_t** of **ccv_comp_t** with detection results.
  */
 CCV_WARN_UNUSED(ccv_array_t*) ccv_icf_detect_objects(ccv_dense_matrix_t* a, void* cascade, int count, ccv_icf_param_t params);
+/**
+ * The same as **ccv_icf_detect_objects**, with the image pyramid taken from, and left in, a shared **ccv_pyramid_t**. A region of interest in params is searched in the **ccv_pyramid_slice** of the pyramid.
+ * @param pyramid The pyramid of the input image.
+ * @param cascade An array of classifier cascades.
+ * @param count How many classifier cascades you've passed in.
+ * @param params A **ccv_icf_param_t** structure that defines various aspects of the detector.
+ * @return A **ccv_array_t** of **ccv_comp_t** with detection results.
+ */
+CCV_WARN_UNUSED(ccv_array_t*) ccv_icf_detect_objects_in_pyramid(ccv_pyramid_t* pyramid, void* cascade, int count, ccv_icf_param_t params);
 /** @} */
 
 /* SCD: SURF-Cascade Detector
@@ -2108,6 +2415,9 @@ typedef struct {
 	int step_through; /**< The step size for detection. */
 	int interval; /**< Interval images between the full size image and the half size one. e.g. 2 will generate 2 images in between full size image and half size one: image with full size, image with 5/6 size, image with 2/3 size, image with 1/2 size. */
 	ccv_size_t size; /**< The smallest object size that will be interesting to us. */
+	ccv_size_t min_size; /**< Scales that only find objects smaller than this are skipped. 0 for no limit. */
+	ccv_size_t max_size; /**< Scales that only find objects larger than this are skipped and their images never computed. 0 for no limit. */
+	ccv_rect_t roi; /**< Only find objects inside this region of the image, the whole image if its width or height is 0. */
 } ccv_scd_param_t;
 
 typedef struct {
@@ -2178,6 +2488,25 @@ void ccv_scd(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type);
  * @return A **ccv_array_t** of **ccv_comp_t** with detection results.
  */
 CCV_WARN_UNUSED(ccv_array_t*) ccv_scd_detect_objects(ccv_dense_matrix_t* a, ccv_scd_classifier_cascade_t** cascades, int count, ccv_scd_param_t params);
+/**
+ * The same as **ccv_scd_detect_objects**, with the image pyramid taken from, and left in, a shared **ccv_pyramid_t**. A region of interest in params is searched in the **ccv_pyramid_slice** of the pyramid.
+ * @param pyramid The pyramid of the input image.
+ * @param cascades An array of classifier cascades.
+ * @param count How many classifier cascades you've passed in.
+ * @param params A **ccv_scd_param_t** structure that defines various aspects of the detector.
+ * @return A **ccv_array_t** of **ccv_comp_t** with detection results.
+ */
+CCV_WARN_UNUSED(ccv_array_t*) ccv_scd_detect_objects_in_pyramid(ccv_pyramid_t* pyramid, ccv_scd_classifier_cascade_t** cascades, int count, ccv_scd_param_t params);
+/**
+ * The same as **ccv_scd_detect_objects** for one frame of a video. Only every few frames are scanned in full, see **ccv_detect_video_t**.
+ * @param video The context of the video, created by **ccv_detect_video_new**.
+ * @param a The frame.
+ * @param cascades An array of classifier cascades.
+ * @param count How many classifier cascades you've passed in.
+ * @param params A **ccv_scd_param_t** structure that defines various aspects of the detector.
+ * @return A **ccv_array_t** of **ccv_comp_t** with detection results.
+ */
+CCV_WARN_UNUSED(ccv_array_t*) ccv_scd_detect_objects_in_video(ccv_detect_video_t* video, ccv_dense_matrix_t* a, ccv_scd_classifier_cascade_t** cascades, int count, ccv_scd_param_t params);
 /** @} */
 
 /* categorization types and methods for training */
@@ -9,6 +9,14 @@
 #ifdef USE_OPENMP
 #include <omp.h>
 #endif
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
 
 const ccv_bbf_param_t ccv_bbf_default_params = {
 	.interval = 5,
@@ -1189,35 +1197,386 @@ static int _ccv_is_equal_same_class(const void* _r1, const void* _r2, void* data
 		   (int)(r2->rect.width * 1.5 + 0.5) >= r1->rect.width;
 }
 
-ccv_array_t* ccv_bbf_detect_objects(ccv_dense_matrix_t* a, ccv_bbf_classifier_cascade_t** _cascade, int count, ccv_bbf_param_t params)
+/* _ccv_is_equal and _ccv_is_equal_same_class only match rectangles whose corners are within distance of each other */
+static int _ccv_is_equal_bound(const void* _r, ccv_rect_t* bound, void* data)
+{
+	const ccv_comp_t* r = (const ccv_comp_t*)_r;
+	int distance = (int)(r->rect.width * 0.25 + 0.5);
+	*bound = ccv_rect(r->rect.x - distance, r->rect.y - distance, distance * 2, distance * 2);
+	return 1;
+}
+
+#define CCV_BBF_BAND_ROWS (16)
+
+typedef struct {
+	int scale;
+	int shift;
+	int y;
+	int rows;
+} ccv_bbf_scan_task_t;
+
+/* the cascade flattened into a few arrays in one block: stages, features and their points follow each
+ * other in evaluation order, so the first stages, which reject nearly every window, sit in a couple of
+ * cache lines instead of behind a pointer per stage. Points with a negative level are dropped, and the
+ * points of P of a feature come before the ones of N */
+typedef struct {
+	int count;
+	ccv_size_t size;
+	int feature_count;
+	int point_count;
+	int* stage; /* count + 1 entries, the first feature of every stage */
+	float* threshold;
+	float* alpha; /* two per feature */
+	int* point; /* feature_count + 1 entries, the first point of every feature */
+	unsigned char* pnum; /* how many of the points of a feature are in P */
+	unsigned char* z;
+	short* x;
+	short* y;
+} ccv_bbf_compiled_cascade_t;
+
+#define _ccv_bbf_align(x) (((x) + 15) & -16)
+
+static ccv_bbf_compiled_cascade_t* _ccv_bbf_compile_cascade(ccv_bbf_classifier_cascade_t* cascade)
+{
+	int i, j, k;
+	int feature_count = 0, point_count = 0;
+	for (i = 0; i < cascade->count; i++)
+	{
+		feature_count += cascade->stage_classifier[i].count;
+		for (j = 0; j < cascade->stage_classifier[i].count; j++)
+		{
+			ccv_bbf_feature_t* feature = cascade->stage_classifier[i].feature + j;
+			/* the first point of P and N is always used, the same as _ccv_run_bbf_feature does */
+			point_count += 2;
+			for (k = 1; k < feature->size; k++)
+				point_count += (feature->pz[k] >= 0) + (feature->nz[k] >= 0);
+		}
+	}
+	size_t stage_size = _ccv_bbf_align(sizeof(int) * (cascade->count + 1));
+	size_t threshold_size = _ccv_bbf_align(sizeof(float) * cascade->count);
+	size_t alpha_size = _ccv_bbf_align(sizeof(float) * 2 * feature_count);
+	size_t point_size = _ccv_bbf_align(sizeof(int) * (feature_count + 1));
+	size_t pnum_size = _ccv_bbf_align(feature_count);
+	size_t z_size = _ccv_bbf_align(point_count);
+	size_t xy_size = _ccv_bbf_align(sizeof(short) * point_count);
+	unsigned char* block = (unsigned char*)ccmalloc(_ccv_bbf_align(sizeof(ccv_bbf_compiled_cascade_t)) + stage_size + threshold_size + alpha_size + point_size + pnum_size + z_size + xy_size * 2);
+	ccv_bbf_compiled_cascade_t* compiled = (ccv_bbf_compiled_cascade_t*)block;
+	compiled->count = cascade->count;
+	compiled->size = cascade->size;
+	compiled->feature_count = feature_count;
+	compiled->point_count = point_count;
+	block += _ccv_bbf_align(sizeof(ccv_bbf_compiled_cascade_t));
+	compiled->stage = (int*)block;
+	compiled->threshold = (float*)(block += stage_size);
+	compiled->alpha = (float*)(block += threshold_size);
+	compiled->point = (int*)(block += alpha_size);
+	compiled->pnum = (unsigned char*)(block += point_size);
+	compiled->z = (unsigned char*)(block += pnum_size);
+	compiled->x = (short*)(block += z_size);
+	compiled->y = (short*)(block += xy_size);
+	int f = 0, p = 0;
+	for (i = 0; i < cascade->count; i++)
+	{
+		ccv_bbf_stage_classifier_t* classifier = cascade->stage_classifier + i;
+		compiled->stage[i] = f;
+		compiled->threshold[i] = classifier->threshold;
+		for (j = 0; j < classifier->count; j++, f++)
+		{
+			ccv_bbf_feature_t* feature = classifier->feature + j;
+			compiled->alpha[f * 2] = classifier->alpha[j * 2];
+			compiled->alpha[f * 2 + 1] = classifier->alpha[j * 2 + 1];
+			compiled->point[f] = p;
+			for (k = 0; k < ccv_max(feature->size, 1); k++)
+				if (k == 0 || feature->pz[k] >= 0)
+				{
+					compiled->z[p] = feature->pz[k];
+					compiled->x[p] = feature->px[k];
+					compiled->y[p] = feature->py[k];
+					p++;
+				}
+			compiled->pnum[f] = p - compiled->point[f];
+			for (k = 0; k < ccv_max(feature->size, 1); k++)
+				if (k == 0 || feature->nz[k] >= 0)
+				{
+					compiled->z[p] = feature->nz[k];
+					compiled->x[p] = feature->nx[k];
+					compiled->y[p] = feature->ny[k];
+					p++;
+				}
+		}
+	}
+	compiled->stage[cascade->count] = f;
+	compiled->point[feature_count] = p;
+	return compiled;
+}
+
+/* the offset of every point from the top left corner of a window, for the row steps of one scale */
+static void _ccv_bbf_compiled_offsets(ccv_bbf_compiled_cascade_t* compiled, int* steps, int* offset)
+{
+	int i;
+	for (i = 0; i < compiled->point_count; i++)
+		offset[i] = compiled->x[i] + compiled->y[i] * steps[compiled->z[i]];
+}
+
+static inline int _ccv_run_bbf_compiled_feature(ccv_bbf_compiled_cascade_t* compiled, int f, const int* offset, unsigned char** u8)
+{
+	int i = compiled->point[f], n = i + compiled->pnum[f], end = compiled->point[f + 1];
+	unsigned char pmin = u8[compiled->z[i]][offset[i]], nmax = u8[compiled->z[n]][offset[n]];
+	/* check if every point in P > every point in N, and take a shortcut */
+	if (pmin <= nmax)
+		return 0;
+	for (++i; i < compiled->point[f] + compiled->pnum[f]; i++)
+	{
+		unsigned char p = u8[compiled->z[i]][offset[i]];
+		if (p <= nmax)
+			return 0;
+		pmin = ccv_min(pmin, p);
+	}
+	for (++n; n < end; n++)
+		if (u8[compiled->z[n]][offset[n]] >= pmin)
+			return 0;
+	return 1;
+}
+
+/* run the cascade from stage on one window, the confidence of the last evaluated stage ends up in sum */
+static inline int _ccv_bbf_run_window(ccv_bbf_compiled_cascade_t* compiled, int stage, const int* offset, unsigned char** u8, float* sum)
+{
+	int j, f;
+	for (j = stage; j < compiled->count; ++j)
+	{
+		*sum = 0;
+		for (f = compiled->stage[j]; f < compiled->stage[j + 1]; ++f)
+			*sum += compiled->alpha[f * 2 + _ccv_run_bbf_compiled_feature(compiled, f, offset, u8)];
+		if (*sum < compiled->threshold[j])
+			return 0;
+	}
+	return 1;
+}
+
+#ifdef HAVE_SSE2
+/* a window one to the right moves 4 pixels on the full size level, 2 on the half size one and 1 on the
+ * quarter size one, these gather the pixels of 16 adjacent windows without reading past the last one */
+static inline __m128i _ccv_bbf_load_stride4(const unsigned char* p)
+{
+	const __m128i mask = _mm_set1_epi32(0xff);
+	__m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)p), mask);
+	__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(p + 16)), mask);
+	__m128i c = _mm_and_si128(_mm_loadu_si128((const __m128i*)(p + 32)), mask);
+	__m128i d = _mm_and_si128(_mm_srli_si128(_mm_loadu_si128((const __m128i*)(p + 45)), 3), mask);
+	return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+}
+
+static inline __m128i _ccv_bbf_load_stride2(const unsigned char* p)
+{
+	const __m128i mask = _mm_set1_epi16(0xff);
+	__m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)p), mask);
+	__m128i b = _mm_and_si128(_mm_srli_si128(_mm_loadu_si128((const __m128i*)(p + 15)), 1), mask);
+	return _mm_packus_epi16(a, b);
+}
+
+static inline __m128i _ccv_bbf_load_16(int z, int offset, unsigned char** u8)
+{
+	const unsigned char* p = u8[z] + offset;
+	return z == 0 ? _ccv_bbf_load_stride4(p) : (z == 1 ? _ccv_bbf_load_stride2(p) : _mm_loadu_si128((const __m128i*)p));
+}
+
+/* the feature of 16 adjacent windows at once, 0xff in every window where all points in P are brighter
+ * than all points in N */
+static inline __m128i _ccv_run_bbf_compiled_feature_16(ccv_bbf_compiled_cascade_t* compiled, int f, const int* offset, unsigned char** u8)
+{
+	int i = compiled->point[f], n = i + compiled->pnum[f], end = compiled->point[f + 1];
+	__m128i pmin = _ccv_bbf_load_16(compiled->z[i], offset[i], u8);
+	for (++i; i < n; i++)
+		pmin = _mm_min_epu8(pmin, _ccv_bbf_load_16(compiled->z[i], offset[i], u8));
+	__m128i nmax = _ccv_bbf_load_16(compiled->z[n], offset[n], u8);
+	for (++n; n < end; n++)
+		nmax = _mm_max_epu8(nmax, _ccv_bbf_load_16(compiled->z[n], offset[n], u8));
+	/* pmin > nmax exactly where the saturated difference is not zero */
+	return _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(pmin, nmax), _mm_setzero_si128()), _mm_set1_epi8(-1));
+}
+
+/* the early stages reject nearly every window, run them on 16 adjacent windows at once as long as enough
+ * of them survive, and finish the few survivors one by one. The sums are added in the same order as the
+ * scalar code, so both agree to the bit */
+#define CCV_BBF_SIMD_MIN_ALIVE (4)
+
+static int _ccv_bbf_run_window_16(ccv_bbf_compiled_cascade_t* compiled, const int* offset, unsigned char** u8, float* confidence)
+{
+	int alive = 0xffff;
+	int j, f, l;
+	__m128 sum[4];
+	for (j = 0; j < compiled->count; ++j)
+	{
+		int n = 0;
+		for (l = 0; l < 16; l++)
+			n += (alive >> l) & 1;
+		if (n < CCV_BBF_SIMD_MIN_ALIVE)
+			break;
+		sum[0] = sum[1] = sum[2] = sum[3] = _mm_setzero_ps();
+		for (f = compiled->stage[j]; f < compiled->stage[j + 1]; ++f)
+		{
+			__m128i m8 = _ccv_run_bbf_compiled_feature_16(compiled, f, offset, u8);
+			__m128i m16lo = _mm_unpacklo_epi8(m8, m8);
+			__m128i m16hi = _mm_unpackhi_epi8(m8, m8);
+			__m128 m[4] = {
+				_mm_castsi128_ps(_mm_unpacklo_epi16(m16lo, m16lo)),
+				_mm_castsi128_ps(_mm_unpackhi_epi16(m16lo, m16lo)),
+				_mm_castsi128_ps(_mm_unpacklo_epi16(m16hi, m16hi)),
+				_mm_castsi128_ps(_mm_unpackhi_epi16(m16hi, m16hi)),
+			};
+			__m128 a0 = _mm_set1_ps(compiled->alpha[f * 2]);
+			__m128 a1 = _mm_set1_ps(compiled->alpha[f * 2 + 1]);
+			for (l = 0; l < 4; l++)
+				sum[l] = _mm_add_ps(sum[l], _mm_or_ps(_mm_and_ps(m[l], a1), _mm_andnot_ps(m[l], a0)));
+		}
+		__m128 threshold = _mm_set1_ps(compiled->threshold[j]);
+		int pass = 0;
+		for (l = 0; l < 4; l++)
+			pass |= _mm_movemask_ps(_mm_cmpge_ps(sum[l], threshold)) << (l * 4);
+		alive &= pass;
+		float lane[16];
+		for (l = 0; l < 4; l++)
+			_mm_storeu_ps(lane + l * 4, sum[l]);
+		for (l = 0; l < 16; l++)
+			confidence[l] = lane[l];
+	}
+	/* finish the survivors from the first stage not run above */
+	if (j < compiled->count)
+		for (l = 0; l < 16; l++)
+			if (alive & (1 << l))
+			{
+				unsigned char* wu8[] = { u8[0] + l * 4, u8[1] + l * 2, u8[2] + l };
+				if (!_ccv_bbf_run_window(compiled, j, offset, wu8, confidence + l))
+					alive &= ~(1 << l);
+			}
+	return alive;
+}
+#endif
+
+static void _ccv_bbf_scan_band(ccv_bbf_compiled_cascade_t* compiled, const int* offset, ccv_dense_matrix_t** pyr, int next, ccv_bbf_scan_task_t* task, float scale_x, float scale_y, int id, ccv_array_t** seq)
+{
+	int dx[] = {0, 1, 0, 1};
+	int dy[] = {0, 0, 1, 1};
+	int i = task->scale, q = task->shift;
+	int l, x, y;
+	int i_cols = pyr[i * 4 + next * 8]->cols - (compiled->size.width >> 2);
+	int paddings[] = { pyr[i * 4]->step * 4 - i_cols * 4,
+					   pyr[i * 4 + next * 4]->step * 2 - i_cols * 2,
+					   pyr[i * 4 + next * 8]->step - i_cols };
+	unsigned char* u8[] = { pyr[i * 4]->data.u8 + dx[q] * 2 + (dy[q] * 2 + task->y * 4) * pyr[i * 4]->step, pyr[i * 4 + next * 4]->data.u8 + dx[q] + (dy[q] + task->y * 2) * pyr[i * 4 + next * 4]->step, pyr[i * 4 + next * 8 + q]->data.u8 + task->y * pyr[i * 4 + next * 8 + q]->step };
+	float confidence[16];
+	for (y = task->y; y < task->y + task->rows; y++)
+	{
+		for (x = 0; x < i_cols;)
+		{
+			int alive, width;
+#ifdef HAVE_SSE2
+			if (x + 16 <= i_cols)
+			{
+				alive = _ccv_bbf_run_window_16(compiled, offset, u8, confidence);
+				width = 16;
+			} else
+#endif
+			{
+				alive = _ccv_bbf_run_window(compiled, 0, offset, u8, confidence);
+				width = 1;
+			}
+			for (l = 0; alive; l++, alive >>= 1)
+				if (alive & 1)
+				{
+					ccv_comp_t comp;
+					comp.rect = ccv_rect((int)(((x + l) * 4 + dx[q] * 2) * scale_x + 0.5), (int)((y * 4 + dy[q] * 2) * scale_y + 0.5), (int)(compiled->size.width * scale_x + 0.5), (int)(compiled->size.height * scale_y + 0.5));
+					comp.neighbors = 1;
+					comp.classification.id = id;
+					comp.classification.confidence = confidence[l];
+					if (!*seq)
+						*seq = ccv_array_new(sizeof(ccv_comp_t), 16, 0);
+					ccv_array_push(*seq, &comp);
+				}
+			x += width;
+			u8[0] += 4 * width;
+			u8[1] += 2 * width;
+			u8[2] += width;
+		}
+		u8[0] += paddings[0];
+		u8[1] += paddings[1];
+		u8[2] += paddings[2];
+	}
+}
+
+ccv_array_t* ccv_bbf_detect_objects_in_pyramid(ccv_pyramid_t* pyramid, ccv_bbf_classifier_cascade_t** _cascade, int count, ccv_bbf_param_t params)
 {
+	int i, j, t;
+	ccv_dense_matrix_t* a = pyramid->a;
+	if (params.roi.width > 0 && params.roi.height > 0)
+	{
+		/* only search inside the region of interest, with its own pyramid that the pyramid keeps for anyone else
+		 * searching the same region, and move what gets found there back into the image */
+		int x = ccv_max(params.roi.x, 0), y = ccv_max(params.roi.y, 0);
+		int cols = ccv_min(params.roi.x + params.roi.width, a->cols) - x;
+		int rows = ccv_min(params.roi.y + params.roi.height, a->rows) - y;
+		params.roi = ccv_rect(0, 0, 0, 0);
+		if (rows <= 0 || cols <= 0)
+			return ccv_array_new(sizeof(ccv_comp_t), 64, 0);
+		if (x > 0 || y > 0 || rows < a->rows || cols < a->cols)
+		{
+			ccv_pyramid_t* part = ccv_pyramid_slice(pyramid, x, y, rows, cols);
+			ccv_array_t* seq = ccv_bbf_detect_objects_in_pyramid(part, _cascade, count, params);
+			ccv_pyramid_release(pyramid, part->a);
+			for (i = 0; i < seq->rnum; i++)
+			{
+				ccv_comp_t* comp = (ccv_comp_t*)ccv_array_get(seq, i);
+				comp->rect.x += x;
+				comp->rect.y += y;
+			}
+			return seq;
+		}
+	}
 	int hr = a->rows / params.size.height;
 	int wr = a->cols / params.size.width;
 	double scale = pow(2., 1. / (params.interval + 1.));
 	int next = params.interval + 1;
 	int scale_upto = (int)(log((double)ccv_min(hr, wr)) / log(scale));
+	/* level i finds objects of params.size * scale^i, the levels outside of min_size and max_size are
+	 * neither scanned nor built */
+	int scale_from = 0;
+	if (params.min_size.width > params.size.width || params.min_size.height > params.size.height)
+		scale_from = (int)ceil(log(ccv_max((double)params.min_size.width / params.size.width, (double)params.min_size.height / params.size.height)) / log(scale) - 1e-6);
+	if (params.max_size.width > 0 && params.max_size.height > 0)
+		scale_upto = ccv_min(scale_upto, (int)floor(log(ccv_min((double)params.max_size.width / params.size.width, (double)params.max_size.height / params.size.height)) / log(scale) + 1e-6) + 1);
+	if (scale_from >= scale_upto)
+		return ccv_array_new(sizeof(ccv_comp_t), 64, 0);
 	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca((scale_upto + next * 2) * 4 * sizeof(ccv_dense_matrix_t*));
 	memset(pyr, 0, (scale_upto + next * 2) * 4 * sizeof(ccv_dense_matrix_t*));
 	if (params.size.height != _cascade[0]->size.height || params.size.width != _cascade[0]->size.width)
-		ccv_resample(a, &pyr[0], 0, a->rows * _cascade[0]->size.height / params.size.height, a->cols * _cascade[0]->size.width / params.size.width, CCV_INTER_AREA);
+		pyr[0] = ccv_pyramid_resample(pyramid, a, a->rows * _cascade[0]->size.height / params.size.height, a->cols * _cascade[0]->size.width / params.size.width, CCV_INTER_AREA);
 	else
 		pyr[0] = a;
-	int i, j, k, t, x, y, q;
-	for (i = 1; i < ccv_min(params.interval + 1, scale_upto + next * 2); i++)
-		ccv_resample(pyr[0], &pyr[i * 4], 0, (int)(pyr[0]->rows / pow(scale, i)), (int)(pyr[0]->cols / pow(scale, i)), CCV_INTER_AREA);
-	for (i = next; i < scale_upto + next * 2; i++)
-		ccv_sample_down(pyr[i * 4 - next * 4], &pyr[i * 4], 0, 0, 0);
+	/* the first octave in use is resampled from the input, every later level is sampled down from the level
+	 * one octave above it, so each of the next chains of levels can be built on its own */
+	parallel_for(r, ccv_min(next, scale_upto + next * 2 - scale_from)) {
+		int l = scale_from + r;
+		if (l > 0)
+			pyr[l * 4] = ccv_pyramid_resample(pyramid, pyr[0], (int)(pyr[0]->rows / pow(scale, l)), (int)(pyr[0]->cols / pow(scale, l)), CCV_INTER_AREA);
+	} parallel_endfor
+	parallel_for(r, next) {
+		int l;
+		for (l = scale_from + next + r; l < scale_upto + next * 2; l += next)
+			pyr[l * 4] = ccv_pyramid_sample_down(pyramid, pyr[l * 4 - next * 4], 0, 0);
+	} parallel_endfor
 	if (params.accurate)
-		for (i = next * 2; i < scale_upto + next * 2; i++)
-		{
-			ccv_sample_down(pyr[i * 4 - next * 4], &pyr[i * 4 + 1], 0, 1, 0);
-			ccv_sample_down(pyr[i * 4 - next * 4], &pyr[i * 4 + 2], 0, 0, 1);
-			ccv_sample_down(pyr[i * 4 - next * 4], &pyr[i * 4 + 3], 0, 1, 1);
-		}
+		parallel_for(r, scale_upto - scale_from) {
+			int l = scale_from + r + next * 2;
+			pyr[l * 4 + 1] = ccv_pyramid_sample_down(pyramid, pyr[l * 4 - next * 4], 1, 0);
+			pyr[l * 4 + 2] = ccv_pyramid_sample_down(pyramid, pyr[l * 4 - next * 4], 0, 1);
+			pyr[l * 4 + 3] = ccv_pyramid_sample_down(pyramid, pyr[l * 4 - next * 4], 1, 1);
+		} parallel_endfor
 	ccv_array_t* idx_seq;
 	ccv_array_t* seq = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
 	ccv_array_t* seq2 = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
 	ccv_array_t* result_seq = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
+	ccv_array_t* tasks = ccv_array_new(sizeof(ccv_bbf_scan_task_t), 64, 0);
+	float* scale_xy = (float*)ccmalloc(sizeof(float) * 2 * ccv_max(scale_upto, 1));
 	/* detect in multi scale */
 	for (t = 0; t < count; t++)
 	{
@@ -1225,60 +1584,53 @@ ccv_array_t* ccv_bbf_detect_objects(ccv_dense_matrix_t* a, ccv_bbf_classifier_ca
 		float scale_x = (float) params.size.width / (float) cascade->size.width;
 		float scale_y = (float) params.size.height / (float) cascade->size.height;
 		ccv_array_clear(seq);
+		ccv_bbf_compiled_cascade_t* compiled = _ccv_bbf_compile_cascade(cascade);
+		/* the point offsets only depend on the row steps, work them out once for every scale */
+		int* offsets = (int*)ccmalloc(sizeof(int) * ccv_max(compiled->point_count * scale_upto, 1));
+		/* split every scale and shift into bands of rows, so the large scales get spread across threads */
+		ccv_array_clear(tasks);
 		for (i = 0; i < scale_upto; i++)
 		{
-			int dx[] = {0, 1, 0, 1};
-			int dy[] = {0, 0, 1, 1};
-			int i_rows = pyr[i * 4 + next * 8]->rows - (cascade->size.height >> 2);
-			int steps[] = { pyr[i * 4]->step, pyr[i * 4 + next * 4]->step, pyr[i * 4 + next * 8]->step };
-			int i_cols = pyr[i * 4 + next * 8]->cols - (cascade->size.width >> 2);
-			int paddings[] = { pyr[i * 4]->step * 4 - i_cols * 4,
-							   pyr[i * 4 + next * 4]->step * 2 - i_cols * 2,
-							   pyr[i * 4 + next * 8]->step - i_cols };
-			for (q = 0; q < (params.accurate ? 4 : 1); q++)
+			scale_xy[i * 2] = scale_x;
+			scale_xy[i * 2 + 1] = scale_y;
+			if (i >= scale_from)
 			{
-				unsigned char* u8[] = { pyr[i * 4]->data.u8 + dx[q] * 2 + dy[q] * pyr[i * 4]->step * 2, pyr[i * 4 + next * 4]->data.u8 + dx[q] + dy[q] * pyr[i * 4 + next * 4]->step, pyr[i * 4 + next * 8 + q]->data.u8 };
-				for (y = 0; y < i_rows; y++)
-				{
-					for (x = 0; x < i_cols; x++)
+				int steps[] = { pyr[i * 4]->step, pyr[i * 4 + next * 4]->step, pyr[i * 4 + next * 8]->step };
+				_ccv_bbf_compiled_offsets(compiled, steps, offsets + compiled->point_count * i);
+				int i_rows = pyr[i * 4 + next * 8]->rows - (cascade->size.height >> 2);
+				int q, y;
+				for (q = 0; q < (params.accurate ? 4 : 1); q++)
+					for (y = 0; y < i_rows; y += CCV_BBF_BAND_ROWS)
 					{
-						float sum;
-						int flag = 1;
-						ccv_bbf_stage_classifier_t* classifier = cascade->stage_classifier;
-						for (j = 0; j < cascade->count; ++j, ++classifier)
-						{
-							sum = 0;
-							float* alpha = classifier->alpha;
-							ccv_bbf_feature_t* feature = classifier->feature;
-							for (k = 0; k < classifier->count; ++k, alpha += 2, ++feature)
-								sum += alpha[_ccv_run_bbf_feature(feature, steps, u8)];
-							if (sum < classifier->threshold)
-							{
-								flag = 0;
-								break;
-							}
-						}
-						if (flag)
-						{
-							ccv_comp_t comp;
-							comp.rect = ccv_rect((int)((x * 4 + dx[q] * 2) * scale_x + 0.5), (int)((y * 4 + dy[q] * 2) * scale_y + 0.5), (int)(cascade->size.width * scale_x + 0.5), (int)(cascade->size.height * scale_y + 0.5));
-							comp.neighbors = 1;
-							comp.classification.id = t;
-							comp.classification.confidence = sum;
-							ccv_array_push(seq, &comp);
-						}
-						u8[0] += 4;
-						u8[1] += 2;
-						u8[2] += 1;
+						ccv_bbf_scan_task_t task = {
+							.scale = i,
+							.shift = q,
+							.y = y,
+							.rows = ccv_min(CCV_BBF_BAND_ROWS, i_rows - y),
+						};
+						ccv_array_push(tasks, &task);
 					}
-					u8[0] += paddings[0];
-					u8[1] += paddings[1];
-					u8[2] += paddings[2];
-				}
 			}
 			scale_x *= scale;
 			scale_y *= scale;
 		}
+		/* every band collects into its own array, and the arrays get merged in order, so the result
+		 * doesn't depend on how the bands were scheduled */
+		ccv_array_t** band_seq = (ccv_array_t**)cccalloc(ccv_max(tasks->rnum, 1), sizeof(ccv_array_t*));
+		parallel_for(k, tasks->rnum) {
+			ccv_bbf_scan_task_t* task = (ccv_bbf_scan_task_t*)ccv_array_get(tasks, k);
+			_ccv_bbf_scan_band(compiled, offsets + compiled->point_count * task->scale, pyr, next, task, scale_xy[task->scale * 2], scale_xy[task->scale * 2 + 1], t, band_seq + k);
+		} parallel_endfor
+		ccfree(offsets);
+		ccfree(compiled);
+		for (i = 0; i < tasks->rnum; i++)
+			if (band_seq[i])
+			{
+				for (j = 0; j < band_seq[i]->rnum; j++)
+					ccv_array_push(seq, ccv_array_get(band_seq[i], j));
+				ccv_array_free(band_seq[i]);
+			}
+		ccfree(band_seq);
 
 		/* the following code from OpenCV's haar feature implementation */
 		if(params.min_neighbors == 0)
@@ -1292,7 +1644,7 @@ ccv_array_t* ccv_bbf_detect_objects(ccv_dense_matrix_t* a, ccv_bbf_classifier_ca
 			idx_seq = 0;
 			ccv_array_clear(seq2);
 			// group retrieved rectangles in order to filter out noise
-			int ncomp = ccv_array_group(seq, &idx_seq, _ccv_is_equal_same_class, 0);
+			int ncomp = ccv_array_group_bounded(seq, &idx_seq, _ccv_is_equal_same_class, _ccv_is_equal_bound, 0);
 			ccv_comp_t* comps = (ccv_comp_t*)ccmalloc((ncomp + 1) * sizeof(ccv_comp_t));
 			memset(comps, 0, (ncomp + 1) * sizeof(ccv_comp_t));
 
@@ -1367,6 +1719,11 @@ ccv_array_t* ccv_bbf_detect_objects(ccv_dense_matrix_t* a, ccv_bbf_classifier_ca
 
 	ccv_array_free(seq);
 	ccv_array_free(seq2);
+	ccv_array_free(tasks);
+	ccfree(scale_xy);
+	for (i = 0; i < (scale_upto + next * 2) * 4; i++)
+		if (pyr[i])
+			ccv_pyramid_release(pyramid, pyr[i]);
 
 	ccv_array_t* result_seq2;
 	/* the following code from OpenCV's haar feature implementation */
@@ -1375,7 +1732,7 @@ ccv_array_t* ccv_bbf_detect_objects(ccv_dense_matrix_t* a, ccv_bbf_classifier_ca
 		result_seq2 = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
 		idx_seq = 0;
 		// group retrieved rectangles in order to filter out noise
-		int ncomp = ccv_array_group(result_seq, &idx_seq, _ccv_is_equal, 0);
+		int ncomp = ccv_array_group_bounded(result_seq, &idx_seq, _ccv_is_equal, _ccv_is_equal_bound, 0);
 		ccv_comp_t* comps = (ccv_comp_t*)ccmalloc((ncomp + 1) * sizeof(ccv_comp_t));
 		memset(comps, 0, (ncomp + 1) * sizeof(ccv_comp_t));
 
@@ -1405,21 +1762,47 @@ ccv_array_t* ccv_bbf_detect_objects(ccv_dense_matrix_t* a, ccv_bbf_classifier_ca
 		result_seq2 = result_seq;
 	}
 
-	for (i = 1; i < scale_upto + next * 2; i++)
-		ccv_matrix_free(pyr[i * 4]);
-	if (params.accurate)
-		for (i = next * 2; i < scale_upto + next * 2; i++)
-		{
-			ccv_matrix_free(pyr[i * 4 + 1]);
-			ccv_matrix_free(pyr[i * 4 + 2]);
-			ccv_matrix_free(pyr[i * 4 + 3]);
-		}
-	if (params.size.height != _cascade[0]->size.height || params.size.width != _cascade[0]->size.width)
-		ccv_matrix_free(pyr[0]);
-
 	return result_seq2;
 }
 
+ccv_array_t* ccv_bbf_detect_objects(ccv_dense_matrix_t* a, ccv_bbf_classifier_cascade_t** cascade, int count, ccv_bbf_param_t params)
+{
+	ccv_pyramid_t* pyramid = ccv_pyramid_new(a);
+	pyramid->retain = 0;
+	ccv_array_t* seq = ccv_bbf_detect_objects_in_pyramid(pyramid, cascade, count, params);
+	ccv_pyramid_free(pyramid);
+	return seq;
+}
+
+ccv_array_t* ccv_bbf_detect_objects_in_video(ccv_detect_video_t* video, ccv_dense_matrix_t* a, ccv_bbf_classifier_cascade_t** cascade, int count, ccv_bbf_param_t params)
+{
+	ccv_rect_t roi = (params.roi.width > 0 && params.roi.height > 0) ? params.roi : ccv_rect(0, 0, a->cols, a->rows);
+	ccv_array_t* regions = ccv_detect_video_regions(video, roi, params.min_size, params.max_size);
+	if (!regions)
+	{
+		ccv_array_t* seq = ccv_bbf_detect_objects(a, cascade, count, params);
+		ccv_detect_video_update(video, seq);
+		return seq;
+	}
+	int i, j;
+	ccv_array_t* seq = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
+	for (i = 0; i < regions->rnum; i++)
+	{
+		ccv_detect_video_region_t* region = (ccv_detect_video_region_t*)ccv_array_get(regions, i);
+		ccv_bbf_param_t region_params = params;
+		region_params.roi = region->roi;
+		region_params.min_size = region->min_size;
+		region_params.max_size = region->max_size;
+		ccv_array_t* region_seq = ccv_bbf_detect_objects(a, cascade, count, region_params);
+		for (j = 0; j < region_seq->rnum; j++)
+			ccv_array_push(seq, ccv_array_get(region_seq, j));
+		ccv_array_free(region_seq);
+	}
+	ccv_array_free(regions);
+	ccv_detect_video_update(video, seq);
+	return seq;
+}
+
 ccv_bbf_classifier_cascade_t* ccv_bbf_read_classifier_cascade(const char* directory)
 {
 	char buf[1024];
@@ -1490,6 +1873,157 @@ int ccv_bbf_classifier_cascade_write_binary(ccv_bbf_classifier_cascade_t* cascad
 	return len;
 }
 
+/* the file starts with this header and a table with one entry per stage. The features and alphas of
+ * every stage follow, aligned to 64 bytes and stored as they are in memory, so the cascade can be used
+ * where it is mapped */
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t count;
+	uint32_t width;
+	uint32_t height;
+	uint32_t feature_size;
+	uint32_t point_max;
+} ccv_bbf_file_header_t;
+
+typedef struct {
+	uint32_t count;
+	float threshold;
+	uint64_t feature;
+	uint64_t alpha;
+} ccv_bbf_file_stage_t;
+
+#define CCV_BBF_FILE_MAGIC "CCVBBFCC"
+#define CCV_BBF_FILE_VERSION (1)
+
+#define _ccv_bbf_file_align(x) (((x) + 63) & ~(uint64_t)63)
+
+int ccv_bbf_classifier_cascade_write_file(ccv_bbf_classifier_cascade_t* cascade, const char* filename)
+{
+	int i;
+	FILE* w = fopen(filename, "wb");
+	if (!w)
+		return CCV_IO_ERROR;
+	ccv_bbf_file_header_t header = {
+		.version = CCV_BBF_FILE_VERSION,
+		.count = cascade->count,
+		.width = cascade->size.width,
+		.height = cascade->size.height,
+		.feature_size = sizeof(ccv_bbf_feature_t),
+		.point_max = CCV_BBF_POINT_MAX,
+	};
+	memcpy(header.magic, CCV_BBF_FILE_MAGIC, 8);
+	ccv_bbf_file_stage_t* stage = (ccv_bbf_file_stage_t*)cccalloc(ccv_max(cascade->count, 1), sizeof(ccv_bbf_file_stage_t));
+	uint64_t offset = _ccv_bbf_file_align(sizeof(header) + sizeof(ccv_bbf_file_stage_t) * cascade->count);
+	for (i = 0; i < cascade->count; i++)
+	{
+		stage[i].count = cascade->stage_classifier[i].count;
+		stage[i].threshold = cascade->stage_classifier[i].threshold;
+		stage[i].feature = offset;
+		stage[i].alpha = _ccv_bbf_file_align(offset + sizeof(ccv_bbf_feature_t) * stage[i].count);
+		offset = _ccv_bbf_file_align(stage[i].alpha + sizeof(float) * 2 * stage[i].count);
+	}
+	static const char padding[64] = {0};
+	int ok = fwrite(&header, sizeof(header), 1, w) == 1 &&
+		fwrite(stage, sizeof(ccv_bbf_file_stage_t), cascade->count, w) == cascade->count;
+	uint64_t written = sizeof(header) + sizeof(ccv_bbf_file_stage_t) * cascade->count;
+	for (i = 0; ok && i < cascade->count; i++)
+	{
+		ok = fwrite(padding, 1, stage[i].feature - written, w) == stage[i].feature - written &&
+			fwrite(cascade->stage_classifier[i].feature, sizeof(ccv_bbf_feature_t), stage[i].count, w) == stage[i].count;
+		written = stage[i].feature + sizeof(ccv_bbf_feature_t) * stage[i].count;
+		ok = ok && fwrite(padding, 1, stage[i].alpha - written, w) == stage[i].alpha - written &&
+			fwrite(cascade->stage_classifier[i].alpha, sizeof(float) * 2, stage[i].count, w) == stage[i].count;
+		written = stage[i].alpha + sizeof(float) * 2 * stage[i].count;
+	}
+	ccfree(stage);
+	if (fclose(w) != 0)
+		ok = 0;
+	return ok ? CCV_IO_FINAL : CCV_IO_ERROR;
+}
+
+ccv_bbf_classifier_cascade_file_t* ccv_bbf_classifier_cascade_read_file(const char* filename)
+{
+	int i;
+	void* map = 0;
+	size_t size = 0;
+#ifdef _WIN32
+	FILE* r = fopen(filename, "rb");
+	if (!r)
+		return 0;
+	fseek(r, 0, SEEK_END);
+	size = ftell(r);
+	fseek(r, 0, SEEK_SET);
+	map = ccmalloc(ccv_max(size, 1));
+	if (fread(map, 1, size, r) != size)
+	{
+		ccfree(map);
+		fclose(r);
+		return 0;
+	}
+	fclose(r);
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < sizeof(ccv_bbf_file_header_t))
+	{
+		close(fd);
+		return 0;
+	}
+	size = st.st_size;
+	map = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+#endif
+	ccv_bbf_file_header_t* header = (ccv_bbf_file_header_t*)map;
+	/* a file from a machine with another byte order fails the version check */
+	int valid = size >= sizeof(ccv_bbf_file_header_t) &&
+		memcmp(header->magic, CCV_BBF_FILE_MAGIC, 8) == 0 &&
+		header->version == CCV_BBF_FILE_VERSION &&
+		header->feature_size == sizeof(ccv_bbf_feature_t) &&
+		header->point_max == CCV_BBF_POINT_MAX &&
+		(size - sizeof(ccv_bbf_file_header_t)) / sizeof(ccv_bbf_file_stage_t) >= header->count;
+	int count = valid ? header->count : 0;
+	/* the stage classifiers only hold pointers into the map, they come right after the file itself */
+	ccv_bbf_classifier_cascade_file_t* file = (ccv_bbf_classifier_cascade_file_t*)ccmalloc(sizeof(ccv_bbf_classifier_cascade_file_t) + sizeof(ccv_bbf_stage_classifier_t) * count);
+	file->map = map;
+	file->size = size;
+	file->cascade.count = count;
+	file->cascade.size = valid ? ccv_size(header->width, header->height) : ccv_size(0, 0);
+	file->cascade.stage_classifier = (ccv_bbf_stage_classifier_t*)(file + 1);
+	ccv_bbf_file_stage_t* stage = (ccv_bbf_file_stage_t*)(header + 1);
+	for (i = 0; valid && i < count; i++)
+	{
+		valid = stage[i].feature % 64 == 0 && stage[i].alpha % 64 == 0 &&
+			stage[i].feature <= size && (size - stage[i].feature) / sizeof(ccv_bbf_feature_t) >= stage[i].count &&
+			stage[i].alpha <= size && (size - stage[i].alpha) / (sizeof(float) * 2) >= stage[i].count;
+		ccv_bbf_stage_classifier_t* classifier = file->cascade.stage_classifier + i;
+		classifier->count = stage[i].count;
+		classifier->threshold = stage[i].threshold;
+		classifier->feature = (ccv_bbf_feature_t*)((unsigned char*)map + stage[i].feature);
+		classifier->alpha = (float*)((unsigned char*)map + stage[i].alpha);
+	}
+	if (!valid)
+	{
+		ccv_bbf_classifier_cascade_file_free(file);
+		return 0;
+	}
+	return file;
+}
+
+void ccv_bbf_classifier_cascade_file_free(ccv_bbf_classifier_cascade_file_t* file)
+{
+#ifdef _WIN32
+	ccfree(file->map);
+#else
+	munmap(file->map, file->size);
+#endif
+	ccfree(file);
+}
+
 void ccv_bbf_classifier_cascade_free(ccv_bbf_classifier_cascade_t* cascade)
 {
 	int i;
@@ -44,17 +44,19 @@ static int _ccv_dpm_scale_upto(ccv_dense_matrix_t* a, ccv_dpm_mixture_model_t**
 	return (int)(log((double)ccv_min(hr, wr)) / log(scale)) - next;
 }
 
-static void _ccv_dpm_feature_pyramid(ccv_dense_matrix_t* a, ccv_dense_matrix_t** pyr, int scale_upto, int interval)
+/* the images come from the pyramid and are released once their hog features are computed, only the hog features
+ * in pyr belong to the caller */
+static void _ccv_dpm_feature_pyramid(ccv_pyramid_t* pyramid, ccv_dense_matrix_t** pyr, int scale_upto, int interval)
 {
 	int next = interval + 1;
 	double scale = pow(2.0, 1.0 / (interval + 1.0));
 	memset(pyr, 0, (scale_upto + next * 2) * sizeof(ccv_dense_matrix_t*));
-	pyr[next] = a;
+	pyr[next] = pyramid->a;
 	int i;
 	for (i = 1; i <= interval; i++)
-		ccv_resample(pyr[next], &pyr[next + i], 0, (int)(pyr[next]->rows / pow(scale, i)), (int)(pyr[next]->cols / pow(scale, i)), CCV_INTER_AREA);
+		pyr[next + i] = ccv_pyramid_resample(pyramid, pyr[next], (int)(pyr[next]->rows / pow(scale, i)), (int)(pyr[next]->cols / pow(scale, i)), CCV_INTER_AREA);
 	for (i = next; i < scale_upto + next; i++)
-		ccv_sample_down(pyr[i], &pyr[i + next], 0, 0, 0);
+		pyr[i + next] = ccv_pyramid_sample_down(pyramid, pyr[i], 0, 0);
 	ccv_dense_matrix_t* hog;
 	/* a more efficient way to generate up-scaled hog (using smaller size) */
 	for (i = 0; i < next; i++)
@@ -70,7 +72,7 @@ static void _ccv_dpm_feature_pyramid(ccv_dense_matrix_t* a, ccv_dense_matrix_t**
 	{
 		hog = 0;
 		ccv_hog(pyr[i], &hog, 0, 9, CCV_DPM_WINDOW_SIZE);
-		ccv_matrix_free(pyr[i]);
+		ccv_pyramid_release(pyramid, pyr[i]);
 		pyr[i] = hog;
 	}
 }
@@ -851,7 +853,9 @@ static ccv_dpm_feature_vector_t* _ccv_dpm_collect_best(ccv_dense_matrix_t* image
 	if (scale_upto < 0)
 		return 0;
 	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca((scale_upto + next * 2) * sizeof(ccv_dense_matrix_t*));
-	_ccv_dpm_feature_pyramid(image, pyr, scale_upto, params.interval);
+	ccv_pyramid_t* pyramid = ccv_pyramid_new(image);
+	_ccv_dpm_feature_pyramid(pyramid, pyr, scale_upto, params.interval);
+	ccv_pyramid_free(pyramid);
 	float best = -FLT_MAX;
 	ccv_dpm_feature_vector_t* v = 0;
 	for (i = 0; i < model->count; i++)
@@ -931,7 +935,9 @@ static ccv_array_t* _ccv_dpm_collect_all(gsl_rng* rng, ccv_dense_matrix_t* image
 	if (scale_upto < 0)
 		return 0;
 	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca((scale_upto + next * 2) * sizeof(ccv_dense_matrix_t*));
-	_ccv_dpm_feature_pyramid(image, pyr, scale_upto, params.interval);
+	ccv_pyramid_t* pyramid = ccv_pyramid_new(image);
+	_ccv_dpm_feature_pyramid(pyramid, pyr, scale_upto, params.interval);
+	ccv_pyramid_free(pyramid);
 	ccv_array_t* av = ccv_array_new(sizeof(ccv_dpm_feature_vector_t*), 64, 0);
 	int enough = 64 / model->count;
 	int* order = (int*)alloca(sizeof(int) * model->count);
@@ -2056,16 +2062,26 @@ static int _ccv_is_equal_same_class(const void* _r1, const void* _r2, void* data
 		(int)(r2->rect.height * 1.5 + 0.5) >= r1->rect.height;
 }
 
-ccv_array_t* ccv_dpm_detect_objects(ccv_dense_matrix_t* a, ccv_dpm_mixture_model_t** _model, int count, ccv_dpm_param_t params)
+/* _ccv_is_equal and _ccv_is_equal_same_class only match rectangles whose corners are within distance of each other */
+static int _ccv_is_equal_bound(const void* _r, ccv_rect_t* bound, void* data)
+{
+	const ccv_root_comp_t* r = (const ccv_root_comp_t*)_r;
+	int distance = (int)(ccv_min(r->rect.width, r->rect.height) * 0.25 + 0.5);
+	*bound = ccv_rect(r->rect.x - distance, r->rect.y - distance, distance * 2, distance * 2);
+	return 1;
+}
+
+ccv_array_t* ccv_dpm_detect_objects_in_pyramid(ccv_pyramid_t* pyramid, ccv_dpm_mixture_model_t** _model, int count, ccv_dpm_param_t params)
 {
 	int c, i, j, k, x, y;
+	ccv_dense_matrix_t* a = pyramid->a;
 	double scale = pow(2.0, 1.0 / (params.interval + 1.0));
 	int next = params.interval + 1;
 	int scale_upto = _ccv_dpm_scale_upto(a, _model, count, params.interval);
 	if (scale_upto < 0) // image is too small to be interesting
 		return 0;
 	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca((scale_upto + next * 2) * sizeof(ccv_dense_matrix_t*));
-	_ccv_dpm_feature_pyramid(a, pyr, scale_upto, params.interval);
+	_ccv_dpm_feature_pyramid(pyramid, pyr, scale_upto, params.interval);
 	ccv_array_t* idx_seq;
 	ccv_array_t* seq = ccv_array_new(sizeof(ccv_root_comp_t), 64, 0);
 	ccv_array_t* seq2 = ccv_array_new(sizeof(ccv_root_comp_t), 64, 0);
@@ -2154,7 +2170,7 @@ ccv_array_t* ccv_dpm_detect_objects(ccv_dense_matrix_t* a, ccv_dpm_mixture_model
 			idx_seq = 0;
 			ccv_array_clear(seq2);
 			// group retrieved rectangles in order to filter out noise
-			int ncomp = ccv_array_group(seq, &idx_seq, _ccv_is_equal_same_class, 0);
+			int ncomp = ccv_array_group_bounded(seq, &idx_seq, _ccv_is_equal_same_class, _ccv_is_equal_bound, 0);
 			ccv_root_comp_t* comps = (ccv_root_comp_t*)ccmalloc((ncomp + 1) * sizeof(ccv_root_comp_t));
 			memset(comps, 0, (ncomp + 1) * sizeof(ccv_root_comp_t));
 
@@ -2255,7 +2271,7 @@ ccv_array_t* ccv_dpm_detect_objects(ccv_dense_matrix_t* a, ccv_dpm_mixture_model
 		result_seq2 = ccv_array_new(sizeof(ccv_root_comp_t), 64, 0);
 		idx_seq = 0;
 		// group retrieved rectangles in order to filter out noise
-		int ncomp = ccv_array_group(result_seq, &idx_seq, _ccv_is_equal, 0);
+		int ncomp = ccv_array_group_bounded(result_seq, &idx_seq, _ccv_is_equal, _ccv_is_equal_bound, 0);
 		ccv_root_comp_t* comps = (ccv_root_comp_t*)ccmalloc((ncomp + 1) * sizeof(ccv_root_comp_t));
 		memset(comps, 0, (ncomp + 1) * sizeof(ccv_root_comp_t));
 
@@ -2290,6 +2306,15 @@ ccv_array_t* ccv_dpm_detect_objects(ccv_dense_matrix_t* a, ccv_dpm_mixture_model
 	return result_seq2;
 }
 
+ccv_array_t* ccv_dpm_detect_objects(ccv_dense_matrix_t* a, ccv_dpm_mixture_model_t** model, int count, ccv_dpm_param_t params)
+{
+	ccv_pyramid_t* pyramid = ccv_pyramid_new(a);
+	pyramid->retain = 0;
+	ccv_array_t* seq = ccv_dpm_detect_objects_in_pyramid(pyramid, model, count, params);
+	ccv_pyramid_free(pyramid);
+	return seq;
+}
+
 ccv_dpm_mixture_model_t* ccv_dpm_read_mixture_model(const char* directory)
 {
 	FILE* r = fopen(directory, "r");
@@ -1,5 +1,8 @@
 #include "ccv.h"
 #include "ccv_internal.h"
+#if defined(HAVE_SSE2)
+#include <emmintrin.h>
+#endif
 #ifdef HAVE_GSL
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
@@ -312,6 +315,150 @@ static inline void _ccv_rgb_to_luv(const float r, const float g, const float b,
 	*pv = (v_value + 140.f) * (255.f / (122.f + 140.f));
 }
 
+// split the gradient magnitude into the 2 nearest of the 6 orientation bins that start at hog
+static inline void _ccv_icf_orientation_bins(const float agv, const float magnitude, float* hog)
+{
+	float agr = (ccv_clamp(agv <= 180 ? agv : agv - 180, 0, 179.99) / 180.0) * 6;
+	int ag0 = (int)agr;
+	int ag1 = ag0 < 5 ? ag0 + 1 : 0;
+	agr = agr - ag0;
+	hog[ag0] = magnitude * (1 - agr);
+	hog[ag1] = magnitude * agr;
+}
+
+// the gradient of the color channel with the largest magnitude
+static inline void _ccv_icf_c3_pixel(const float* agp, const float* mgp, const float magnitude_scaling, float* dbp)
+{
+	int k;
+	float agv = agp[0];
+	float mgv = mgp[0];
+	for (k = 1; k < 3; k++)
+	{
+		if (mgp[k] > mgv)
+		{
+			mgv = mgp[k];
+			agv = agp[k];
+		}
+	}
+	dbp[3] = mgv * magnitude_scaling;
+	_ccv_icf_orientation_bins(agv, dbp[3], dbp + 4);
+}
+
+#ifdef HAVE_SSE2
+// the orientation bins of 4 pixels the same way _ccv_icf_orientation_bins does, with the angle math in double as well
+static inline void _ccv_icf_orientation_bins_sse2(__m128 ag4, __m128 m4, __m128 hog4[6])
+{
+	__m128 _180 = _mm_set1_ps(180);
+	ag4 = _mm_sub_ps(ag4, _mm_andnot_ps(_mm_cmple_ps(ag4, _180), _180));
+	__m128d zero = _mm_setzero_pd(), _179_99 = _mm_set1_pd(179.99), _180d = _mm_set1_pd(180.0), _6 = _mm_set1_pd(6);
+	__m128d agl = _mm_mul_pd(_mm_div_pd(_mm_min_pd(_mm_max_pd(_mm_cvtps_pd(ag4), zero), _179_99), _180d), _6);
+	__m128d agh = _mm_mul_pd(_mm_div_pd(_mm_min_pd(_mm_max_pd(_mm_cvtps_pd(_mm_movehl_ps(ag4, ag4)), zero), _179_99), _180d), _6);
+	__m128 agr = _mm_movelh_ps(_mm_cvtpd_ps(agl), _mm_cvtpd_ps(agh));
+	__m128i ag0 = _mm_cvttps_epi32(agr);
+	agr = _mm_sub_ps(agr, _mm_cvtepi32_ps(ag0));
+	__m128 w0 = _mm_mul_ps(m4, _mm_sub_ps(_mm_set1_ps(1), agr));
+	__m128 w1 = _mm_mul_ps(m4, agr);
+	int k;
+	for (k = 0; k < 6; k++)
+	{
+		__m128 mask0 = _mm_castsi128_ps(_mm_cmpeq_epi32(ag0, _mm_set1_epi32(k)));
+		__m128 mask1 = _mm_castsi128_ps(_mm_cmpeq_epi32(ag0, _mm_set1_epi32(k > 0 ? k - 1 : 5)));
+		hog4[k] = _mm_or_ps(_mm_and_ps(mask0, w0), _mm_and_ps(mask1, w1));
+	}
+}
+
+static int _ccv_icf_c1_8u(unsigned char* a_ptr, float* agp, float* mgp, const float magnitude_scaling, float* dbp, int cols)
+{
+	int j;
+	__m128 scaling4 = _mm_set1_ps(magnitude_scaling);
+	for (j = 0; j < cols - 3; j += 4, dbp += 32)
+	{
+		__m128 v4 = _mm_setr_ps(a_ptr[j], a_ptr[j + 1], a_ptr[j + 2], a_ptr[j + 3]);
+		__m128 m4 = _mm_mul_ps(_mm_loadu_ps(mgp + j), scaling4);
+		__m128 hog4[6];
+		_ccv_icf_orientation_bins_sse2(_mm_loadu_ps(agp + j), m4, hog4);
+		// back to 8 interleaved channels per pixel
+		__m128 c0 = v4, c1 = m4, c2 = hog4[0], c3 = hog4[1];
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		__m128 c4 = hog4[2], c5 = hog4[3], c6 = hog4[4], c7 = hog4[5];
+		_MM_TRANSPOSE4_PS(c4, c5, c6, c7);
+		_mm_storeu_ps(dbp, c0);
+		_mm_storeu_ps(dbp + 4, c4);
+		_mm_storeu_ps(dbp + 8, c1);
+		_mm_storeu_ps(dbp + 12, c5);
+		_mm_storeu_ps(dbp + 16, c2);
+		_mm_storeu_ps(dbp + 20, c6);
+		_mm_storeu_ps(dbp + 24, c3);
+		_mm_storeu_ps(dbp + 28, c7);
+	}
+	return j;
+}
+
+static int _ccv_icf_c3_8u(unsigned char* a_ptr, float* agp, float* mgp, const float magnitude_scaling, const float* unit, float* dbp, int cols)
+{
+	const float x_n = 0.312713f, y_n = 0.329016f;
+	const float uv_n_divisor = -2.f * x_n + 12.f * y_n + 3.f;
+	const float u_n = 4.f * x_n / uv_n_divisor;
+	const float v_n = 9.f * y_n / uv_n_divisor;
+	__m128 u_n4 = _mm_set1_ps(u_n), v_n4 = _mm_set1_ps(v_n), eps4 = _mm_set1_ps(FLT_EPSILON), zero4 = _mm_setzero_ps();
+	__m128 scaling4 = _mm_set1_ps(magnitude_scaling);
+	int j, k;
+	for (j = 0; j < cols - 3; j += 4, a_ptr += 12, agp += 12, mgp += 12, dbp += 40)
+	{
+		__m128 r = _mm_setr_ps(unit[a_ptr[0]], unit[a_ptr[3]], unit[a_ptr[6]], unit[a_ptr[9]]);
+		__m128 g = _mm_setr_ps(unit[a_ptr[1]], unit[a_ptr[4]], unit[a_ptr[7]], unit[a_ptr[10]]);
+		__m128 b = _mm_setr_ps(unit[a_ptr[2]], unit[a_ptr[5]], unit[a_ptr[8]], unit[a_ptr[11]]);
+		__m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.412453f), r), _mm_mul_ps(_mm_set1_ps(0.35758f), g)), _mm_mul_ps(_mm_set1_ps(0.180423f), b));
+		__m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.212671f), r), _mm_mul_ps(_mm_set1_ps(0.71516f), g)), _mm_mul_ps(_mm_set1_ps(0.072169f), b));
+		__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.019334f), r), _mm_mul_ps(_mm_set1_ps(0.119193f), g)), _mm_mul_ps(_mm_set1_ps(0.950227f), b));
+		__m128 uv_divisor = _mm_max_ps(_mm_add_ps(_mm_add_ps(x, _mm_mul_ps(_mm_set1_ps(15.f), y)), _mm_mul_ps(_mm_set1_ps(3.f), z)), eps4);
+		__m128 u = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(4.f), x), uv_divisor);
+		__m128 v = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(9.f), y), uv_divisor);
+		float yv[4];
+		_mm_storeu_ps(yv, y);
+		__m128 y_cube_root = _mm_setr_ps(fast_cube_root(yv[0]), fast_cube_root(yv[1]), fast_cube_root(yv[2]), fast_cube_root(yv[3]));
+		__m128 l_value = _mm_max_ps(zero4, _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(116.f), y_cube_root), _mm_set1_ps(16.f)));
+		__m128 l13 = _mm_mul_ps(_mm_set1_ps(13.f), l_value);
+		__m128 l4 = _mm_mul_ps(l_value, _mm_set1_ps(255.f / 100.f));
+		__m128 u4 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(l13, _mm_sub_ps(u, u_n4)), _mm_set1_ps(134.f)), _mm_set1_ps(255.f / (220.f + 134.f)));
+		__m128 v4 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(l13, _mm_sub_ps(v, v_n4)), _mm_set1_ps(140.f)), _mm_set1_ps(255.f / (122.f + 140.f)));
+		// the gradient of the color channel with the largest magnitude, the first one of them on ties
+		__m128 mgv = _mm_setr_ps(mgp[0], mgp[3], mgp[6], mgp[9]);
+		__m128 agv = _mm_setr_ps(agp[0], agp[3], agp[6], agp[9]);
+		for (k = 1; k < 3; k++)
+		{
+			__m128 mgk = _mm_setr_ps(mgp[k], mgp[k + 3], mgp[k + 6], mgp[k + 9]);
+			__m128 agk = _mm_setr_ps(agp[k], agp[k + 3], agp[k + 6], agp[k + 9]);
+			__m128 mask = _mm_cmpgt_ps(mgk, mgv);
+			mgv = _mm_or_ps(_mm_and_ps(mask, mgk), _mm_andnot_ps(mask, mgv));
+			agv = _mm_or_ps(_mm_and_ps(mask, agk), _mm_andnot_ps(mask, agv));
+		}
+		__m128 m4 = _mm_mul_ps(mgv, scaling4);
+		__m128 hog4[6];
+		_ccv_icf_orientation_bins_sse2(agv, m4, hog4);
+		// back to 10 interleaved channels per pixel
+		__m128 c0 = l4, c1 = u4, c2 = v4, c3 = m4;
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		__m128 c4 = hog4[0], c5 = hog4[1], c6 = hog4[2], c7 = hog4[3];
+		_MM_TRANSPOSE4_PS(c4, c5, c6, c7);
+		__m128 c8 = _mm_unpacklo_ps(hog4[4], hog4[5]), c9 = _mm_unpackhi_ps(hog4[4], hog4[5]);
+		_mm_storeu_ps(dbp, c0);
+		_mm_storeu_ps(dbp + 4, c4);
+		_mm_storel_pi((__m64*)(dbp + 8), c8);
+		_mm_storeu_ps(dbp + 10, c1);
+		_mm_storeu_ps(dbp + 14, c5);
+		_mm_storeh_pi((__m64*)(dbp + 18), c8);
+		_mm_storeu_ps(dbp + 20, c2);
+		_mm_storeu_ps(dbp + 24, c6);
+		_mm_storel_pi((__m64*)(dbp + 28), c9);
+		_mm_storeu_ps(dbp + 30, c3);
+		_mm_storeu_ps(dbp + 34, c7);
+		_mm_storeh_pi((__m64*)(dbp + 38), c9);
+	}
+	return j;
+}
+#endif
+
 // generating the integrate channels features (which combines the grayscale, gradient magnitude, and 6-direction HOG)
 void ccv_icf(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type)
 {
@@ -328,9 +475,44 @@ void ccv_icf(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type)
 	float* mgp = mg->data.f32;
 	float* dbp = db->data.f32;
 	ccv_zero(db);
-	int i, j, k;
+	int i, j;
 	unsigned char* a_ptr = a->data.u8;
 	float magnitude_scaling = 1 / sqrtf(2); // regularize it to 0~1
+#ifdef HAVE_SSE2
+	if (CCV_GET_DATA_TYPE(a->type) == CCV_8U)
+	{
+		// the same as the generic path below, 4 pixels at a time
+		float unit[256];
+		for (i = 0; i < 256; i++)
+			unit[i] = i / 255.0;
+		for (i = 0; i < a->rows; i++)
+		{
+			if (ch == 1)
+			{
+				j = _ccv_icf_c1_8u(a_ptr, agp, mgp, magnitude_scaling, dbp, a->cols);
+				for (dbp += j * 8; j < a->cols; j++, dbp += 8)
+				{
+					dbp[0] = a_ptr[j];
+					dbp[1] = mgp[j] * magnitude_scaling;
+					_ccv_icf_orientation_bins(agp[j], dbp[1], dbp + 2);
+				}
+			} else {
+				j = _ccv_icf_c3_8u(a_ptr, agp, mgp, magnitude_scaling, unit, dbp, a->cols);
+				for (dbp += j * 10; j < a->cols; j++, dbp += 10)
+				{
+					_ccv_rgb_to_luv(unit[a_ptr[j * 3]], unit[a_ptr[j * 3 + 1]], unit[a_ptr[j * 3 + 2]], dbp, dbp + 1, dbp + 2);
+					_ccv_icf_c3_pixel(agp + j * 3, mgp + j * 3, magnitude_scaling, dbp);
+				}
+			}
+			a_ptr += a->step;
+			agp += a->cols * ch;
+			mgp += a->cols * ch;
+		}
+		ccv_matrix_free(ag);
+		ccv_matrix_free(mg);
+		return;
+	}
+#endif
 	if (ch == 1)
 	{
 #define for_block(_, _for_get) \
@@ -340,12 +522,7 @@ void ccv_icf(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type)
 			{ \
 				dbp[0] = _for_get(a_ptr, j, 0); \
 				dbp[1] = mgp[j] * magnitude_scaling; \
-				float agr = (ccv_clamp(agp[j] <= 180 ? agp[j] : agp[j] - 180, 0, 179.99) / 180.0) * 6; \
-				int ag0 = (int)agr; \
-				int ag1 = ag0 < 5 ? ag0 + 1 : 0; \
-				agr = agr - ag0; \
-				dbp[2 + ag0] = dbp[1] * (1 - agr); \
-				dbp[2 + ag1] = dbp[1] * agr; \
+				_ccv_icf_orientation_bins(agp[j], dbp[1], dbp + 2); \
 				dbp += 8; \
 			} \
 			a_ptr += a->step; \
@@ -365,23 +542,7 @@ void ccv_icf(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type)
 								_for_get(a_ptr, j * ch + 1, 0) / 255.0, \
 								_for_get(a_ptr, j * ch + 2, 0) / 255.0, \
 								dbp, dbp + 1, dbp + 2); \
-				float agv = agp[j * ch]; \
-				float mgv = mgp[j * ch]; \
-				for (k = 1; k < ch; k++) \
-				{ \
-					if (mgp[j * ch + k] > mgv) \
-					{ \
-						mgv = mgp[j * ch + k]; \
-						agv = agp[j * ch + k]; \
-					} \
-				} \
-				dbp[3] = mgv * magnitude_scaling; \
-				float agr = (ccv_clamp(agv <= 180 ? agv : agv - 180, 0, 179.99) / 180.0) * 6; \
-				int ag0 = (int)agr; \
-				int ag1 = ag0 < 5 ? ag0 + 1 : 0; \
-				agr = agr - ag0; \
-				dbp[4 + ag0] = dbp[3] * (1 - agr); \
-				dbp[4 + ag1] = dbp[3] * agr; \
+				_ccv_icf_c3_pixel(agp + j * ch, mgp + j * ch, magnitude_scaling, dbp); \
 				dbp += 10; \
 			} \
 			a_ptr += a->step; \
@@ -1965,96 +2126,692 @@ static int _ccv_is_equal_same_class(const void* _r1, const void* _r2, void* data
 		(int)(r2->rect.height * 1.5 + 0.5) >= r1->rect.height;
 }
 
-static void _ccv_icf_detect_objects_with_classifier_cascade(ccv_dense_matrix_t* a, ccv_icf_classifier_cascade_t** cascades, int count, ccv_icf_param_t params, ccv_array_t* seq[])
+/* _ccv_is_equal_same_class only matches rectangles whose corners are within distance of each other */
+static int _ccv_is_equal_bound(const void* _r, ccv_rect_t* bound, void* data)
+{
+	const ccv_comp_t* r = (const ccv_comp_t*)_r;
+	int distance = (int)(ccv_min(r->rect.width, r->rect.height) * 0.25 + 0.5);
+	*bound = ccv_rect(r->rect.x - distance, r->rect.y - distance, distance * 2, distance * 2);
+	return 1;
+}
+
+/* whether objects of this size are neither smaller than min_size nor larger than max_size */
+static inline int _ccv_icf_is_size_in_range(double width, double height, ccv_icf_param_t params)
+{
+	return width >= params.min_size.width && height >= params.min_size.height &&
+		(params.max_size.width <= 0 || params.max_size.height <= 0 || (width <= params.max_size.width && height <= params.max_size.height));
+}
+
+/* level i finds objects between 2^i and 2^(i+1) times the size of a cascade */
+static int _ccv_icf_is_level_in_range(ccv_icf_classifier_cascade_t** cascades, int count, int i, ccv_icf_param_t params)
+{
+	int j;
+	for (j = 0; j < count; j++)
+	{
+		double width = (cascades[j]->size.width - cascades[j]->margin.left - cascades[j]->margin.right) * (double)(1 << i);
+		double height = (cascades[j]->size.height - cascades[j]->margin.top - cascades[j]->margin.bottom) * (double)(1 << i);
+		if (width * 2 >= params.min_size.width && height * 2 >= params.min_size.height &&
+			(params.max_size.width <= 0 || params.max_size.height <= 0 || (width <= params.max_size.width && height <= params.max_size.height)))
+			return 1;
+	}
+	return 0;
+}
+
+typedef struct {
+	int si;
+	float alpha;
+} ccv_icf_area_alpha_t;
+
+// the area weights of the source pixels covered by [start + i * step, start + (i + 1) * step) for each of the count destination pixels
+static void _ccv_icf_area_alpha(double start, double step, int count, int limit, int* ofs, ccv_icf_area_alpha_t* alpha)
+{
+	int i, j, k = 0;
+	for (i = 0; i < count; i++)
+	{
+		ofs[i] = k;
+		double f1 = start + i * step, f2 = f1 + step;
+		for (j = (int)f1; j < f2; j++)
+		{
+			double w = ccv_min(f2, j + 1) - ccv_max(f1, j);
+			if (w > 1e-6)
+			{
+				alpha[k].si = ccv_clamp(j, 0, limit - 1);
+				alpha[k++].alpha = (float)(w / step);
+			}
+		}
+	}
+	ofs[count] = k;
+}
+
+#ifdef HAVE_SSE2
+static int _ccv_icf_area_column(float* buf, float* a_ptr, float beta, int count)
+{
+	int j;
+	__m128 b4 = _mm_set1_ps(beta);
+	for (j = 0; j < count - 3; j += 4)
+		_mm_storeu_ps(buf + j, _mm_add_ps(_mm_loadu_ps(buf + j), _mm_mul_ps(_mm_loadu_ps(a_ptr + j), b4)));
+	return j;
+}
+
+// the 10 channels of a pixel in 3 registers, the last one holding 2 of them
+static int _ccv_icf_area_row_c10(float* buf, float* b_ptr, int cols, int* xofs, ccv_icf_area_alpha_t* xalpha, float ratio)
+{
+	int j, p;
+	__m128 r0 = _mm_setr_ps(1, 1, 1, ratio);
+	__m128 r1 = _mm_set1_ps(ratio);
+	for (j = 0; j < cols; j++, b_ptr += 10)
+	{
+		__m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps(), s2 = _mm_setzero_ps();
+		for (p = xofs[j]; p < xofs[j + 1]; p++)
+		{
+			float* s_ptr = buf + xalpha[p].si * 10;
+			__m128 alpha = _mm_set1_ps(xalpha[p].alpha);
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(s_ptr), alpha));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(s_ptr + 4), alpha));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadl_pi(_mm_setzero_ps(), (__m64*)(s_ptr + 8)), alpha));
+		}
+		_mm_storeu_ps(b_ptr, _mm_mul_ps(s0, r0));
+		_mm_storeu_ps(b_ptr + 4, _mm_mul_ps(s1, r1));
+		_mm_storel_pi((__m64*)(b_ptr + 8), _mm_mul_ps(s2, r1));
+	}
+	return cols;
+}
+#endif
+
+static void _ccv_icf_area_row(float* buf, float* b_ptr, int cols, int* xofs, ccv_icf_area_alpha_t* xalpha, int ch, float ratio)
+{
+	int j = 0, k, p;
+#ifdef HAVE_SSE2
+	if (ch == 10)
+		j = _ccv_icf_area_row_c10(buf, b_ptr, cols, xofs, xalpha, ratio);
+#endif
+	for (b_ptr += j * ch; j < cols; j++, b_ptr += ch)
+	{
+		for (k = 0; k < ch; k++)
+			b_ptr[k] = 0;
+		for (p = xofs[j]; p < xofs[j + 1]; p++)
+		{
+			float* s_ptr = buf + xalpha[p].si * ch;
+			float alpha = xalpha[p].alpha;
+			for (k = 0; k < ch; k++)
+				b_ptr[k] += s_ptr[k] * alpha;
+		}
+		// the last 7 channels are the gradient magnitude and the 6-direction HOG
+		for (k = ch - 7; k < ch; k++)
+			b_ptr[k] *= ratio;
+	}
+}
+
+/* the channels of an image_rows x image_cols image scaled down to rows x cols and bordered by margin, extrapolated from the
+ * exact channels of that image bordered by twice the margin: area resampled, and with the gradient channels scaled by
+ * scale ^ 0.3, the power law they follow across scales (Dollar et al., Fast Feature Pyramids for Object Detection).
+ * The paper has 0.1 for its smoothed, normalized gradients, 0.3 is what these unsmoothed ones follow on the samples. */
+static ccv_dense_matrix_t* _ccv_icf_approximate_channels(ccv_dense_matrix_t* icf, ccv_margin_t margin, int image_rows, int image_cols, int rows, int cols)
+{
+	double scale_y = (double)image_rows / rows, scale_x = (double)image_cols / cols;
+	rows += margin.top + margin.bottom;
+	cols += margin.left + margin.right;
+	ccv_dense_matrix_t* b = ccv_dense_matrix_new(rows, cols, icf->type, 0, 0);
+	int i, j, q, ch = CCV_GET_CHANNEL(icf->type);
+	int* yofs = (int*)ccmalloc(sizeof(int) * (rows + cols + 2));
+	int* xofs = yofs + rows + 1;
+	ccv_icf_area_alpha_t* yalpha = (ccv_icf_area_alpha_t*)ccmalloc(sizeof(ccv_icf_area_alpha_t) * (rows + cols) * 4);
+	ccv_icf_area_alpha_t* xalpha = yalpha + rows * 4;
+	_ccv_icf_area_alpha(margin.top * (2 - scale_y), scale_y, rows, icf->rows, yofs, yalpha);
+	_ccv_icf_area_alpha(margin.left * (2 - scale_x), scale_x, cols, icf->cols, xofs, xalpha);
+	float ratio = powf(sqrtf(scale_x * scale_y), 0.3);
+	float* buf = (float*)ccmalloc(sizeof(float) * icf->cols * ch);
+	for (i = 0; i < rows; i++)
+	{
+		// vertically first, over whole source rows, then horizontally over the fewer destination pixels
+		memset(buf, 0, sizeof(float) * icf->cols * ch);
+		for (q = yofs[i]; q < yofs[i + 1]; q++)
+		{
+			float* a_ptr = (float*)(icf->data.u8 + icf->step * yalpha[q].si);
+			float beta = yalpha[q].alpha;
+			j = 0;
+#ifdef HAVE_SSE2
+			j = _ccv_icf_area_column(buf, a_ptr, beta, icf->cols * ch);
+#endif
+			for (; j < icf->cols * ch; j++)
+				buf[j] += a_ptr[j] * beta;
+		}
+		float* b_ptr = (float*)(b->data.u8 + b->step * i);
+		_ccv_icf_area_row(buf, b_ptr, cols, xofs, xalpha, ch, ratio);
+	}
+	ccfree(buf);
+	ccfree(yalpha);
+	ccfree(yofs);
+	return b;
+}
+
+static inline int _ccv_icf_is_same_margin(ccv_margin_t a, ccv_margin_t b)
+{
+	return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+#define CCV_ICF_BAND_ROWS (16)
+
+typedef struct {
+	int sat; // which one of the integral images that are scanned together
+	int cascade;
+	int k; // which cascade of a multiscale one
+	double scale;
+	int y;
+	int rows;
+	int* offset; // the corners of the rectangles of the cascade in the integral image
+} ccv_icf_scan_task_t;
+
+/* the cascade flattened into a few arrays in one block: trees, their 3 features and the rectangles of these
+ * follow each other in evaluation order, so the first trees, which reject nearly every window, sit in a few
+ * cache lines */
+typedef struct {
+	int count;
+	ccv_size_t size;
+	int rect_count;
+	uint32_t* pass;
+	float* weigh; /* two per tree */
+	float* threshold;
+	float* beta; /* three per tree */
+	int* rect; /* 3 * count + 1 entries, the first rectangle of every feature */
+	int* channel;
+	float* alpha;
+	ccv_point_t* sat; /* the top left and the bottom right corners of every rectangle */
+} ccv_icf_compiled_cascade_t;
+
+#define _ccv_icf_align(x) (((x) + 15) & -16)
+
+static ccv_icf_compiled_cascade_t* _ccv_icf_compile_cascade(ccv_icf_classifier_cascade_t* cascade)
+{
+	int i, j, k;
+	int rect_count = 0;
+	for (i = 0; i < cascade->count; i++)
+		for (j = 0; j < 3; j++)
+			rect_count += cascade->weak_classifiers[i].features[j].count;
+	size_t pass_size = _ccv_icf_align(sizeof(uint32_t) * cascade->count);
+	size_t weigh_size = _ccv_icf_align(sizeof(float) * 2 * cascade->count);
+	size_t threshold_size = _ccv_icf_align(sizeof(float) * cascade->count);
+	size_t beta_size = _ccv_icf_align(sizeof(float) * 3 * cascade->count);
+	size_t rect_size = _ccv_icf_align(sizeof(int) * (3 * cascade->count + 1));
+	size_t channel_size = _ccv_icf_align(sizeof(int) * rect_count);
+	size_t alpha_size = _ccv_icf_align(sizeof(float) * rect_count);
+	size_t sat_size = _ccv_icf_align(sizeof(ccv_point_t) * 2 * rect_count);
+	unsigned char* block = (unsigned char*)ccmalloc(_ccv_icf_align(sizeof(ccv_icf_compiled_cascade_t)) + pass_size + weigh_size + threshold_size + beta_size + rect_size + channel_size + alpha_size + sat_size);
+	ccv_icf_compiled_cascade_t* compiled = (ccv_icf_compiled_cascade_t*)block;
+	compiled->count = cascade->count;
+	compiled->size = cascade->size;
+	compiled->rect_count = rect_count;
+	block += _ccv_icf_align(sizeof(ccv_icf_compiled_cascade_t));
+	compiled->pass = (uint32_t*)block;
+	compiled->weigh = (float*)(block += pass_size);
+	compiled->threshold = (float*)(block += weigh_size);
+	compiled->beta = (float*)(block += threshold_size);
+	compiled->rect = (int*)(block += beta_size);
+	compiled->channel = (int*)(block += rect_size);
+	compiled->alpha = (float*)(block += channel_size);
+	compiled->sat = (ccv_point_t*)(block += alpha_size);
+	int r = 0;
+	for (i = 0; i < cascade->count; i++)
+	{
+		ccv_icf_decision_tree_t* weak_classifier = cascade->weak_classifiers + i;
+		compiled->pass[i] = weak_classifier->pass;
+		compiled->weigh[i * 2] = weak_classifier->weigh[0];
+		compiled->weigh[i * 2 + 1] = weak_classifier->weigh[1];
+		compiled->threshold[i] = weak_classifier->threshold;
+		for (j = 0; j < 3; j++)
+		{
+			ccv_icf_feature_t* feature = weak_classifier->features + j;
+			compiled->beta[i * 3 + j] = feature->beta;
+			compiled->rect[i * 3 + j] = r;
+			for (k = 0; k < feature->count; k++, r++)
+			{
+				compiled->channel[r] = feature->channel[k];
+				compiled->alpha[r] = feature->alpha[k];
+				compiled->sat[r * 2] = feature->sat[k * 2];
+				compiled->sat[r * 2 + 1] = feature->sat[k * 2 + 1];
+			}
+		}
+	}
+	compiled->rect[cascade->count * 3] = r;
+	return compiled;
+}
+
+/* the 4 corners of every rectangle only depend on the row length of the integral image, work them out once
+ * for it, in the order _ccv_icf_run_feature adds them up */
+static void _ccv_icf_compiled_offsets(ccv_icf_compiled_cascade_t* compiled, int cols, int ch, int* offset)
+{
+	int r;
+	for (r = 0; r < compiled->rect_count; r++)
+	{
+		ccv_point_t p0 = compiled->sat[r * 2], p1 = compiled->sat[r * 2 + 1];
+		int c = compiled->channel[r];
+		offset[r * 4] = (p1.x + 1 + (p1.y + 1) * cols) * ch + c;
+		offset[r * 4 + 1] = (p0.x + (p1.y + 1) * cols) * ch + c;
+		offset[r * 4 + 2] = (p0.x + p0.y * cols) * ch + c;
+		offset[r * 4 + 3] = (p1.x + 1 + p0.y * cols) * ch + c;
+	}
+}
+
+/* the bands of an integral image scanned with a cascade follow each other in the tasks, and share the offsets */
+static void _ccv_icf_compile_task_offsets(ccv_array_t* tasks, ccv_icf_compiled_cascade_t** compiled, int stride, ccv_dense_matrix_t** sats)
+{
+	int i;
+	for (i = 0; i < tasks->rnum; i++)
+	{
+		ccv_icf_scan_task_t* task = (ccv_icf_scan_task_t*)ccv_array_get(tasks, i);
+		ccv_icf_scan_task_t* prev = i > 0 ? (ccv_icf_scan_task_t*)ccv_array_get(tasks, i - 1) : 0;
+		if (prev && prev->sat == task->sat && prev->cascade == task->cascade && prev->k == task->k)
+			task->offset = prev->offset;
+		else {
+			ccv_icf_compiled_cascade_t* cascade = compiled[task->cascade * stride + task->k];
+			task->offset = (int*)ccmalloc(sizeof(int) * 4 * ccv_max(cascade->rect_count, 1));
+			_ccv_icf_compiled_offsets(cascade, sats[task->sat]->cols, CCV_GET_CHANNEL(sats[task->sat]->type), task->offset);
+		}
+	}
+}
+
+static void _ccv_icf_free_task_offsets(ccv_array_t* tasks)
+{
+	int i;
+	for (i = 0; i < tasks->rnum; i++)
+	{
+		ccv_icf_scan_task_t* task = (ccv_icf_scan_task_t*)ccv_array_get(tasks, i);
+		if (i == 0 || ((ccv_icf_scan_task_t*)ccv_array_get(tasks, i - 1))->offset != task->offset)
+			ccfree(task->offset);
+	}
+}
+
+static inline float _ccv_icf_run_compiled_feature(ccv_icf_compiled_cascade_t* compiled, int f, const int* offset, const float* ptr)
+{
+	float c = compiled->beta[f];
+	int r;
+	for (r = compiled->rect[f]; r < compiled->rect[f + 1]; r++)
+		c += (ptr[offset[r * 4]] - ptr[offset[r * 4 + 1]] + ptr[offset[r * 4 + 2]] - ptr[offset[r * 4 + 3]]) * compiled->alpha[r];
+	return c;
+}
+
+/* run the trees from the j-th on in the window at ptr, adding onto the sum in confidence, the same way
+ * _ccv_icf_run_weak_classifier does */
+static int _ccv_icf_run_compiled_window(ccv_icf_compiled_cascade_t* compiled, int j, const int* offset, const float* ptr, float* confidence)
+{
+	float sum = *confidence;
+	for (; j < compiled->count; j++)
+	{
+		int c;
+		if (_ccv_icf_run_compiled_feature(compiled, j * 3, offset, ptr) > 0)
+			c = (compiled->pass[j] & 0x1) ? _ccv_icf_run_compiled_feature(compiled, j * 3 + 2, offset, ptr) > 0 : 1;
+		else
+			c = (compiled->pass[j] & 0x2) ? _ccv_icf_run_compiled_feature(compiled, j * 3 + 1, offset, ptr) > 0 : 0;
+		sum += compiled->weigh[j * 2 + c];
+		if (sum < compiled->threshold[j])
+		{
+			*confidence = sum;
+			return 0;
+		}
+	}
+	*confidence = sum;
+	return 1;
+}
+
+#ifdef HAVE_SSE2
+static inline void _ccv_icf_run_compiled_feature_8(ccv_icf_compiled_cascade_t* compiled, int f, const int* offset, float** lane, __m128 c[2])
+{
+	int r, h;
+	c[0] = c[1] = _mm_set1_ps(compiled->beta[f]);
+	for (r = compiled->rect[f]; r < compiled->rect[f + 1]; r++)
+	{
+		const int* o = offset + r * 4;
+		__m128 alpha = _mm_set1_ps(compiled->alpha[r]);
+		for (h = 0; h < 2; h++)
+		{
+			float** l = lane + h * 4;
+			__m128 p0 = _mm_setr_ps(l[0][o[0]], l[1][o[0]], l[2][o[0]], l[3][o[0]]);
+			__m128 p1 = _mm_setr_ps(l[0][o[1]], l[1][o[1]], l[2][o[1]], l[3][o[1]]);
+			__m128 p2 = _mm_setr_ps(l[0][o[2]], l[1][o[2]], l[2][o[2]], l[3][o[2]]);
+			__m128 p3 = _mm_setr_ps(l[0][o[3]], l[1][o[3]], l[2][o[3]], l[3][o[3]]);
+			c[h] = _mm_add_ps(c[h], _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_sub_ps(p0, p1), p2), p3), alpha));
+		}
+	}
+}
+
+/* the early trees reject nearly every window, run them on 8 windows at once as long as enough of them survive,
+ * and finish the few survivors one by one. The sums are added in the same order as the scalar code, so both
+ * agree to the bit */
+#define CCV_ICF_SIMD_MIN_ALIVE (3)
+
+static int _ccv_icf_run_window_8(ccv_icf_compiled_cascade_t* compiled, const int* offset, float** lane, float* confidence)
+{
+	int alive = 0xff;
+	int j, h, l;
+	__m128 zero = _mm_setzero_ps();
+	__m128 sum[2] = { zero, zero };
+	for (j = 0; j < compiled->count; j++)
+	{
+		int n = 0;
+		for (l = 0; l < 8; l++)
+			n += (alive >> l) & 1;
+		if (n < CCV_ICF_SIMD_MIN_ALIVE)
+			break;
+		__m128 c[2], m[2], r0[2] = { zero, zero }, r1[2];
+		_ccv_icf_run_compiled_feature_8(compiled, j * 3, offset, lane, c);
+		m[0] = _mm_cmpgt_ps(c[0], zero);
+		m[1] = _mm_cmpgt_ps(c[1], zero);
+		int positive = _mm_movemask_ps(m[0]) | (_mm_movemask_ps(m[1]) << 4);
+		r1[0] = r1[1] = _mm_cmpeq_ps(zero, zero);
+		// only the features that some of the windows alive go on to
+		if ((compiled->pass[j] & 0x1) && (positive & alive))
+		{
+			_ccv_icf_run_compiled_feature_8(compiled, j * 3 + 2, offset, lane, c);
+			r1[0] = _mm_cmpgt_ps(c[0], zero);
+			r1[1] = _mm_cmpgt_ps(c[1], zero);
+		}
+		if ((compiled->pass[j] & 0x2) && (~positive & alive))
+		{
+			_ccv_icf_run_compiled_feature_8(compiled, j * 3 + 1, offset, lane, c);
+			r0[0] = _mm_cmpgt_ps(c[0], zero);
+			r0[1] = _mm_cmpgt_ps(c[1], zero);
+		}
+		__m128 w0 = _mm_set1_ps(compiled->weigh[j * 2]);
+		__m128 w1 = _mm_set1_ps(compiled->weigh[j * 2 + 1]);
+		__m128 threshold = _mm_set1_ps(compiled->threshold[j]);
+		int pass = 0;
+		for (h = 0; h < 2; h++)
+		{
+			__m128 k = _mm_or_ps(_mm_and_ps(m[h], r1[h]), _mm_andnot_ps(m[h], r0[h]));
+			sum[h] = _mm_add_ps(sum[h], _mm_or_ps(_mm_and_ps(k, w1), _mm_andnot_ps(k, w0)));
+			pass |= _mm_movemask_ps(_mm_cmpge_ps(sum[h], threshold)) << (h * 4);
+		}
+		alive &= pass;
+	}
+	_mm_storeu_ps(confidence, sum[0]);
+	_mm_storeu_ps(confidence + 4, sum[1]);
+	/* finish the survivors from the first tree not run above */
+	if (j < compiled->count)
+		for (l = 0; l < 8; l++)
+			if ((alive & (1 << l)) && !_ccv_icf_run_compiled_window(compiled, j, offset, lane[l], confidence + l))
+				alive &= ~(1 << l);
+	return alive;
+}
+#endif
+
+static void _ccv_icf_scan_band(ccv_icf_compiled_cascade_t* compiled, ccv_margin_t margin, ccv_dense_matrix_t* sat, ccv_icf_param_t params, ccv_icf_scan_task_t* task, ccv_array_t** seq)
+{
+	int l, x, y;
+	int ch = CCV_GET_CHANNEL(sat->type);
+	// the integral image has one more row and column than the bordered image it is computed from
+	int cols = ccv_min(sat->cols - 1, sat->cols - compiled->size.width - 1);
+	int* offset = task->offset;
+	float* ptr = sat->data.f32 + sat->cols * ch * task->y;
+	float confidence[8];
+	for (y = task->y; y < task->y + task->rows; y += params.step_through)
+	{
+		for (x = 0; x < cols;)
+		{
+			int alive, width;
+#ifdef HAVE_SSE2
+			if (x + 7 * params.step_through < cols)
+			{
+				float* lane[8];
+				for (l = 0; l < 8; l++)
+					lane[l] = ptr + (x + l * params.step_through) * ch;
+				alive = _ccv_icf_run_window_8(compiled, offset, lane, confidence);
+				width = 8;
+			} else
+#endif
+			{
+				confidence[0] = 0;
+				alive = _ccv_icf_run_compiled_window(compiled, 0, offset, ptr + x * ch, confidence);
+				width = 1;
+			}
+			for (l = 0; alive; l++, alive >>= 1)
+				if (alive & 1)
+				{
+					int wx = x + l * params.step_through;
+					ccv_comp_t comp;
+					comp.rect = ccv_rect((int)((wx + 0.5) * task->scale - 0.5), (int)((y + 0.5) * task->scale - 0.5), (compiled->size.width - margin.left - margin.right) * task->scale, (compiled->size.height - margin.top - margin.bottom) * task->scale);
+					comp.neighbors = 1;
+					comp.classification.id = task->cascade + 1;
+					comp.classification.confidence = confidence[l];
+					if (!*seq)
+						*seq = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
+					ccv_array_push(*seq, &comp);
+				}
+			x += width * params.step_through;
+		}
+		ptr += sat->cols * ch * params.step_through;
+	}
+}
+
+/* every band collects into its own array, and the arrays get merged in task order, so the result doesn't
+ * depend on how the bands were scheduled */
+static void _ccv_icf_merge_bands(ccv_array_t* tasks, ccv_array_t** band_seq, ccv_array_t* seq[])
+{
+	int i, j;
+	for (i = 0; i < tasks->rnum; i++)
+		if (band_seq[i])
+		{
+			ccv_icf_scan_task_t* task = (ccv_icf_scan_task_t*)ccv_array_get(tasks, i);
+			for (j = 0; j < band_seq[i]->rnum; j++)
+				ccv_array_push(seq[task->cascade], ccv_array_get(band_seq[i], j));
+			ccv_array_free(band_seq[i]);
+		}
+}
+
+static void _ccv_icf_detect_objects_with_classifier_cascade(ccv_pyramid_t* pyramid, ccv_icf_classifier_cascade_t** cascades, int count, ccv_icf_param_t params, ccv_array_t* seq[])
 {
-	int i, j, k, q, x, y;
+	int i, j, k, q, y;
+	ccv_dense_matrix_t* a = pyramid->a;
 	int scale_upto = 1;
 	for (i = 0; i < count; i++)
 		scale_upto = ccv_max(scale_upto, (int)(log(ccv_min((double)a->rows / (cascades[i]->size.height - cascades[i]->margin.top - cascades[i]->margin.bottom), (double)a->cols / (cascades[i]->size.width - cascades[i]->margin.left - cascades[i]->margin.right))) / log(2.) - DBL_MIN) + 1);
-	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca(sizeof(ccv_dense_matrix_t*) * scale_upto);
+	/* the levels that only find objects outside of min_size and max_size are never built */
+	int scale_from = 0;
+	while (scale_from < scale_upto && !_ccv_icf_is_level_in_range(cascades, count, scale_from, params))
+		++scale_from;
+	while (scale_upto > scale_from && !_ccv_icf_is_level_in_range(cascades, count, scale_upto - 1, params))
+		--scale_upto;
+	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca(sizeof(ccv_dense_matrix_t*) * ccv_max(scale_upto, 1));
 	pyr[0] = a;
-	for (i = 1; i < scale_upto; i++)
+	for (i = ccv_max(scale_from, 1); i < scale_upto; i++)
+		pyr[i] = i == scale_from ? ccv_pyramid_resample(pyramid, a, a->rows >> i, a->cols >> i, CCV_INTER_AREA) : ccv_pyramid_sample_down(pyramid, pyr[i - 1], 0, 0);
+	// cascades with the same margin share the channel features of each scale, the first one of them stands for all
+	int* group = (int*)alloca(sizeof(int) * count);
+	int groups = 0;
+	for (j = 0; j < count; j++)
 	{
-		pyr[i] = 0;
-		ccv_sample_down(pyr[i - 1], &pyr[i], 0, 0, 0);
+		for (q = 0; q < j; q++)
+			if (_ccv_icf_is_same_margin(cascades[q]->margin, cascades[j]->margin))
+				break;
+		if (q == j)
+			group[groups++] = j;
 	}
-	for (i = 0; i < scale_upto; i++)
+	int next = params.interval + 1;
+	double* scales = (double*)alloca(sizeof(double) * next);
+	double scale_ratio = pow(2., 1. / next);
+	scales[0] = 1;
+	for (k = 1; k < next; k++)
+		scales[k] = scales[k - 1] * scale_ratio;
+	ccv_icf_compiled_cascade_t** compiled = (ccv_icf_compiled_cascade_t**)alloca(sizeof(ccv_icf_compiled_cascade_t*) * count);
+	for (j = 0; j < count; j++)
+		compiled[j] = _ccv_icf_compile_cascade(cascades[j]);
+	ccv_dense_matrix_t** exact = (ccv_dense_matrix_t**)alloca(sizeof(ccv_dense_matrix_t*) * groups);
+	ccv_dense_matrix_t** sats = (ccv_dense_matrix_t**)ccmalloc(sizeof(ccv_dense_matrix_t*) * groups * next);
+	int* in_use = (int*)ccmalloc(sizeof(int) * groups * next);
+	ccv_array_t* tasks = ccv_array_new(sizeof(ccv_icf_scan_task_t), 64, 0);
+	for (i = scale_from; i < scale_upto; i++)
 	{
-		// run it
-		for (j = 0; j < count; j++)
+		/* the integral images of all the interval images and margins of an octave are computed in parallel,
+		 * and then scanned in parallel bands of rows, an octave at a time to keep only its integral images around */
+		ccv_array_clear(tasks);
+		memset(in_use, 0, sizeof(int) * groups * next);
+		for (j = 0; j < groups; j++)
 		{
-			double scale_ratio = pow(2., 1. / (params.interval + 1));
-			double scale = 1;
-			ccv_icf_classifier_cascade_t* cascade = cascades[j];
-			for (k = 0; k <= params.interval; k++)
+			ccv_margin_t margin = cascades[group[j]]->margin;
+			for (k = 0; k < next; k++)
 			{
-				int rows = (int)(pyr[i]->rows / scale + 0.5);
-				int cols = (int)(pyr[i]->cols / scale + 0.5);
-				if (rows < cascade->size.height || cols < cascade->size.width)
-					break;
-				ccv_dense_matrix_t* image = k == 0 ? pyr[i] : 0;
-				if (k > 0)
-					ccv_resample(pyr[i], &image, 0, rows, cols, CCV_INTER_AREA);
-				ccv_dense_matrix_t* bordered = 0;
-				ccv_border(image, (ccv_matrix_t**)&bordered, 0, cascade->margin);
-				if (k > 0)
-					ccv_matrix_free(image);
-				rows = bordered->rows;
-				cols = bordered->cols;
-				ccv_dense_matrix_t* icf = 0;
-				ccv_icf(bordered, &icf, 0);
-				ccv_matrix_free(bordered);
-				ccv_dense_matrix_t* sat = 0;
-				ccv_sat(icf, &sat, 0, CCV_PADDING_ZERO);
-				ccv_matrix_free(icf);
-				int ch = CCV_GET_CHANNEL(sat->type);
-				float* ptr = sat->data.f32;
-				for (y = 0; y < rows; y += params.step_through)
+				int rows = (int)(pyr[i]->rows / scales[k] + 0.5);
+				int cols = (int)(pyr[i]->cols / scales[k] + 0.5);
+				for (q = group[j]; q < count; q++)
 				{
-					if (y >= sat->rows - cascade->size.height - 1)
-						break;
-					for (x = 0; x < cols; x += params.step_through)
+					ccv_icf_classifier_cascade_t* cascade = cascades[q];
+					if (!_ccv_icf_is_same_margin(cascade->margin, margin) || rows < cascade->size.height || cols < cascade->size.width ||
+						!_ccv_icf_is_size_in_range((cascade->size.width - margin.left - margin.right) * scales[k] * (1 << i), (cascade->size.height - margin.top - margin.bottom) * scales[k] * (1 << i), params))
+						continue;
+					in_use[j * next + k] = 1;
+					// the windows that fit in the bordered image
+					int scan_rows = rows + margin.top + margin.bottom - cascade->size.height;
+					for (y = 0; y < scan_rows; y += CCV_ICF_BAND_ROWS * params.step_through)
 					{
-						if (x >= sat->cols - cascade->size.width - 1)
-							break;
-						int pass = 1;
-						float sum = 0;
-						for (q = 0; q < cascade->count; q++)
-						{
-							ccv_icf_decision_tree_t* weak_classifier = cascade->weak_classifiers + q;
-							int c = _ccv_icf_run_weak_classifier(weak_classifier, ptr, sat->cols, ch, x, 0);
-							sum += weak_classifier->weigh[c];
-							if (sum < weak_classifier->threshold)
-							{
-								pass = 0;
-								break;
-							}
-						}
-						if (pass)
-						{
-							ccv_comp_t comp;
-							comp.rect = ccv_rect((int)((x + 0.5) * scale * (1 << i) - 0.5), (int)((y + 0.5) * scale * (1 << i) - 0.5), (cascade->size.width - cascade->margin.left - cascade->margin.right) * scale * (1 << i), (cascade->size.height - cascade->margin.top - cascade->margin.bottom) * scale * (1 << i));
-							comp.neighbors = 1;
-							comp.classification.id = j + 1;
-							comp.classification.confidence = sum;
-							ccv_array_push(seq[j], &comp);
-						}
+						ccv_icf_scan_task_t task = {
+							.sat = j * next + k,
+							.cascade = q,
+							.k = 0,
+							.scale = scales[k] * (1 << i),
+							.y = y,
+							.rows = ccv_min(CCV_ICF_BAND_ROWS * params.step_through, scan_rows - y),
+						};
+						ccv_array_push(tasks, &task);
 					}
-					ptr += sat->cols * ch * params.step_through;
 				}
-				ccv_matrix_free(sat);
-				scale *= scale_ratio;
 			}
 		}
+		memset(exact, 0, sizeof(ccv_dense_matrix_t*) * groups);
+		if (params.flags & CCV_ICF_APPROXIMATE_PYRAMID)
+			parallel_for(g, groups) {
+				ccv_margin_t margin = cascades[group[g]]->margin;
+				ccv_dense_matrix_t* bordered = 0;
+				ccv_margin_t exact_margin = {
+					.left = margin.left * 2,
+					.top = margin.top * 2,
+					.right = margin.right * 2,
+					.bottom = margin.bottom * 2,
+				};
+				ccv_border(pyr[i], (ccv_matrix_t**)&bordered, 0, exact_margin);
+				ccv_icf(bordered, exact + g, 0);
+				ccv_matrix_free(bordered);
+			} parallel_endfor
+		parallel_for(t, groups * next) {
+			sats[t] = 0;
+			if (in_use[t])
+			{
+				ccv_margin_t margin = cascades[group[t / next]]->margin;
+				int rows = (int)(pyr[i]->rows / scales[t % next] + 0.5);
+				int cols = (int)(pyr[i]->cols / scales[t % next] + 0.5);
+				ccv_dense_matrix_t* icf = 0;
+				if (exact[t / next])
+					icf = _ccv_icf_approximate_channels(exact[t / next], margin, pyr[i]->rows, pyr[i]->cols, rows, cols);
+				else {
+					ccv_dense_matrix_t* image = t % next == 0 ? pyr[i] : ccv_pyramid_resample(pyramid, pyr[i], rows, cols, CCV_INTER_AREA);
+					ccv_dense_matrix_t* bordered = 0;
+					ccv_border(image, (ccv_matrix_t**)&bordered, 0, margin);
+					if (t % next != 0)
+						ccv_pyramid_release(pyramid, image);
+					ccv_icf(bordered, &icf, 0);
+					ccv_matrix_free(bordered);
+				}
+				ccv_sat(icf, sats + t, 0, CCV_PADDING_ZERO);
+				ccv_matrix_free(icf);
+			}
+		} parallel_endfor
+		for (j = 0; j < groups; j++)
+			if (exact[j])
+				ccv_matrix_free(exact[j]);
+		_ccv_icf_compile_task_offsets(tasks, compiled, 1, sats);
+		ccv_array_t** band_seq = (ccv_array_t**)cccalloc(ccv_max(tasks->rnum, 1), sizeof(ccv_array_t*));
+		parallel_for(n, tasks->rnum) {
+			ccv_icf_scan_task_t* task = (ccv_icf_scan_task_t*)ccv_array_get(tasks, n);
+			_ccv_icf_scan_band(compiled[task->cascade], cascades[task->cascade]->margin, sats[task->sat], params, task, band_seq + n);
+		} parallel_endfor
+		_ccv_icf_merge_bands(tasks, band_seq, seq);
+		ccfree(band_seq);
+		_ccv_icf_free_task_offsets(tasks);
+		for (j = 0; j < groups * next; j++)
+			if (sats[j])
+				ccv_matrix_free(sats[j]);
+		ccv_pyramid_release(pyramid, pyr[i]);
 	}
+	ccv_array_free(tasks);
+	ccfree(in_use);
+	ccfree(sats);
+	for (j = 0; j < count; j++)
+		ccfree(compiled[j]);
+}
 
-	for (i = 1; i < scale_upto; i++)
-		ccv_matrix_free(pyr[i]);
+/* whether any cascade of any multiscale cascade finds objects of the right size on level i */
+static int _ccv_icf_is_multiscale_level_in_range(ccv_icf_multiscale_classifier_cascade_t** multiscale_cascade, int count, int i, ccv_icf_param_t params)
+{
+	int j, k;
+	for (j = 0; j < count; j++)
+		for (k = i > 0 ? multiscale_cascade[j]->count - (multiscale_cascade[j]->count / multiscale_cascade[j]->octave) : 0; k < multiscale_cascade[j]->count; k++)
+		{
+			ccv_icf_classifier_cascade_t* cascade = multiscale_cascade[j]->cascade + k;
+			if (_ccv_icf_is_size_in_range((cascade->size.width - cascade->margin.left - cascade->margin.right) << i, (cascade->size.height - cascade->margin.top - cascade->margin.bottom) << i, params))
+				return 1;
+		}
+	return 0;
+}
+
+static void _ccv_icf_scan_multiscale_band(ccv_icf_compiled_cascade_t* compiled, ccv_margin_t cascade_margin, ccv_dense_matrix_t* sat, ccv_margin_t margin, int image_cols, ccv_icf_param_t params, ccv_icf_scan_task_t* task, ccv_array_t** seq)
+{
+	int l, x, y, iy;
+	int ch = CCV_GET_CHANNEL(sat->type);
+	int i = task->sat;
+	double scale = task->scale;
+	int cols = (int)(image_cols / scale + cascade_margin.left + 0.5);
+	int top = margin.top - cascade_margin.top;
+	int left = margin.left - cascade_margin.left;
+	int* offset = task->offset;
+	// the windows stop where they would run out of the integral image
+	int x_end = 0;
+	while (x_end < cols && (int)((x_end + 0.5) * scale + left) < sat->cols - compiled->size.width - 1)
+		x_end += params.step_through;
+	float confidence[8];
+	for (y = task->y; y < task->y + task->rows; y += params.step_through)
+	{
+		iy = (int)((y + 0.5) * scale + top);
+		if (iy >= sat->rows - compiled->size.height - 1)
+			break;
+		float* ptr = sat->data.f32 + sat->cols * ch * iy;
+		for (x = 0; x < x_end;)
+		{
+			int alive, width;
+#ifdef HAVE_SSE2
+			if (x + 7 * params.step_through < x_end)
+			{
+				float* lane[8];
+				for (l = 0; l < 8; l++)
+					lane[l] = ptr + (int)((x + l * params.step_through + 0.5) * scale + left) * ch;
+				alive = _ccv_icf_run_window_8(compiled, offset, lane, confidence);
+				width = 8;
+			} else
+#endif
+			{
+				confidence[0] = 0;
+				alive = _ccv_icf_run_compiled_window(compiled, 0, offset, ptr + (int)((x + 0.5) * scale + left) * ch, confidence);
+				width = 1;
+			}
+			for (l = 0; alive; l++, alive >>= 1)
+				if (alive & 1)
+				{
+					int wx = x + l * params.step_through;
+					ccv_comp_t comp;
+					comp.rect = ccv_rect((int)((wx + 0.5) * scale * (1 << i)), (int)((y + 0.5) * scale * (1 << i)), (compiled->size.width - cascade_margin.left - cascade_margin.right) << i, (compiled->size.height - cascade_margin.top - cascade_margin.bottom) << i);
+					comp.neighbors = 1;
+					comp.classification.id = task->cascade + 1;
+					comp.classification.confidence = confidence[l];
+					if (!*seq)
+						*seq = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
+					ccv_array_push(*seq, &comp);
+				}
+			x += width * params.step_through;
+		}
+	}
 }
 
-static void _ccv_icf_detect_objects_with_multiscale_classifier_cascade(ccv_dense_matrix_t* a, ccv_icf_multiscale_classifier_cascade_t** multiscale_cascade, int count, ccv_icf_param_t params, ccv_array_t* seq[])
+static void _ccv_icf_detect_objects_with_multiscale_classifier_cascade(ccv_pyramid_t* pyramid, ccv_icf_multiscale_classifier_cascade_t** multiscale_cascade, int count, ccv_icf_param_t params, ccv_array_t* seq[])
 {
-	int i, j, k, q, x, y, ix, iy, py;
+	int i, j, k, y;
+	ccv_dense_matrix_t* a = pyramid->a;
 	assert(multiscale_cascade[0]->count % multiscale_cascade[0]->octave == 0);
 	ccv_margin_t margin = multiscale_cascade[0]->cascade[multiscale_cascade[0]->count - 1].margin;
 	for (i = 1; i < count; i++)
@@ -2072,96 +2829,115 @@ static void _ccv_icf_detect_objects_with_multiscale_classifier_cascade(ccv_dense
 	int scale_upto = 1;
 	for (i = 0; i < count; i++)
 		scale_upto = ccv_max(scale_upto, (int)(log(ccv_min((double)a->rows / (multiscale_cascade[i]->cascade[0].size.height - multiscale_cascade[i]->cascade[0].margin.top - multiscale_cascade[i]->cascade[0].margin.bottom), (double)a->cols / (multiscale_cascade[i]->cascade[0].size.width - multiscale_cascade[i]->cascade[0].margin.left - multiscale_cascade[i]->cascade[0].margin.right))) / log(2.) - DBL_MIN) + 2 - multiscale_cascade[i]->octave);
-	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca(sizeof(ccv_dense_matrix_t*) * scale_upto);
+	int scale_from = 0;
+	while (scale_from < scale_upto && !_ccv_icf_is_multiscale_level_in_range(multiscale_cascade, count, scale_from, params))
+		++scale_from;
+	while (scale_upto > scale_from && !_ccv_icf_is_multiscale_level_in_range(multiscale_cascade, count, scale_upto - 1, params))
+		--scale_upto;
+	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca(sizeof(ccv_dense_matrix_t*) * ccv_max(scale_upto, 1));
 	pyr[0] = a;
-	for (i = 1; i < scale_upto; i++)
-	{
-		pyr[i] = 0;
-		ccv_sample_down(pyr[i - 1], &pyr[i], 0, 0, 0);
-	}
-	for (i = 0; i < scale_upto; i++)
-	{
+	for (i = ccv_max(scale_from, 1); i < scale_upto; i++)
+		pyr[i] = i == scale_from ? ccv_pyramid_resample(pyramid, a, a->rows >> i, a->cols >> i, CCV_INTER_AREA) : ccv_pyramid_sample_down(pyramid, pyr[i - 1], 0, 0);
+	/* the integral images of all the levels are computed in parallel, and then scanned in parallel bands of rows */
+	ccv_dense_matrix_t** sats = (ccv_dense_matrix_t**)alloca(sizeof(ccv_dense_matrix_t*) * ccv_max(scale_upto, 1));
+	parallel_for(l, scale_upto - scale_from) {
 		ccv_dense_matrix_t* bordered = 0;
-		ccv_border(pyr[i], (ccv_matrix_t**)&bordered, 0, margin);
+		ccv_border(pyr[scale_from + l], (ccv_matrix_t**)&bordered, 0, margin);
 		ccv_dense_matrix_t* icf = 0;
 		ccv_icf(bordered, &icf, 0);
 		ccv_matrix_free(bordered);
-		ccv_dense_matrix_t* sat = 0;
-		ccv_sat(icf, &sat, 0, CCV_PADDING_ZERO);
+		sats[scale_from + l] = 0;
+		ccv_sat(icf, sats + scale_from + l, 0, CCV_PADDING_ZERO);
 		ccv_matrix_free(icf);
-		int ch = CCV_GET_CHANNEL(sat->type);
-		assert(CCV_GET_DATA_TYPE(sat->type) == CCV_32F);
-		// run it
+		assert(CCV_GET_DATA_TYPE(sats[scale_from + l]->type) == CCV_32F);
+	} parallel_endfor
+	ccv_array_t* tasks = ccv_array_new(sizeof(ccv_icf_scan_task_t), 64, 0);
+	for (i = scale_from; i < scale_upto; i++)
 		for (j = 0; j < count; j++)
 		{
 			double scale_ratio = pow(2., (double)multiscale_cascade[j]->octave / multiscale_cascade[j]->count);
 			int starter = i > 0 ? multiscale_cascade[j]->count - (multiscale_cascade[j]->count / multiscale_cascade[j]->octave) : 0;
 			double scale = pow(scale_ratio, starter);
-			for (k = starter; k < multiscale_cascade[j]->count; k++)
+			for (k = starter; k < multiscale_cascade[j]->count; k++, scale *= scale_ratio)
 			{
 				ccv_icf_classifier_cascade_t* cascade = multiscale_cascade[j]->cascade + k;
+				if (!_ccv_icf_is_size_in_range((cascade->size.width - cascade->margin.left - cascade->margin.right) << i, (cascade->size.height - cascade->margin.top - cascade->margin.bottom) << i, params))
+					continue;
 				int rows = (int)(pyr[i]->rows / scale + cascade->margin.top + 0.5);
-				int cols = (int)(pyr[i]->cols / scale + cascade->margin.left + 0.5);
 				int top = margin.top - cascade->margin.top;
 				int right = margin.right - cascade->margin.right;
 				int bottom = margin.bottom - cascade->margin.bottom;
 				int left = margin.left - cascade->margin.left;
-				if (sat->rows - top - bottom <= cascade->size.height || sat->cols - left - right <= cascade->size.width)
+				if (sats[i]->rows - top - bottom <= cascade->size.height || sats[i]->cols - left - right <= cascade->size.width)
 					break;
-				float* ptr = sat->data.f32 + top * sat->cols * ch;
-				for (y = 0, iy = py = top; y < rows; y += params.step_through)
+				for (y = 0; y < rows; y += CCV_ICF_BAND_ROWS * params.step_through)
 				{
-					iy = (int)((y + 0.5) * scale + top);
-					if (iy >= sat->rows - cascade->size.height - 1)
-						break;
-					if (iy > py)
-					{
-						ptr += sat->cols * ch * (iy - py);
-						py = iy;
-					}
-					for (x = 0; x < cols; x += params.step_through)
-					{
-						ix = (int)((x + 0.5) * scale + left);
-						if (ix >= sat->cols - cascade->size.width - 1)
-							break;
-						int pass = 1;
-						float sum = 0;
-						for (q = 0; q < cascade->count; q++)
-						{
-							ccv_icf_decision_tree_t* weak_classifier = cascade->weak_classifiers + q;
-							int c = _ccv_icf_run_weak_classifier(weak_classifier, ptr, sat->cols, ch, ix, 0);
-							sum += weak_classifier->weigh[c];
-							if (sum < weak_classifier->threshold)
-							{
-								pass = 0;
-								break;
-							}
-						}
-						if (pass)
-						{
-							ccv_comp_t comp;
-							comp.rect = ccv_rect((int)((x + 0.5) * scale * (1 << i)), (int)((y + 0.5) * scale * (1 << i)), (cascade->size.width - cascade->margin.left - cascade->margin.right) << i, (cascade->size.height - cascade->margin.top - cascade->margin.bottom) << i);
-							comp.neighbors = 1;
-							comp.classification.id = j + 1;
-							comp.classification.confidence = sum;
-							ccv_array_push(seq[j], &comp);
-						}
-					}
+					ccv_icf_scan_task_t task = {
+						.sat = i,
+						.cascade = j,
+						.k = k,
+						.scale = scale,
+						.y = y,
+						.rows = ccv_min(CCV_ICF_BAND_ROWS * params.step_through, rows - y),
+					};
+					ccv_array_push(tasks, &task);
 				}
-				scale *= scale_ratio;
 			}
 		}
-		ccv_matrix_free(sat);
+	// all the multiscale cascades have the same number of cascades
+	ccv_icf_compiled_cascade_t** compiled = (ccv_icf_compiled_cascade_t**)ccmalloc(sizeof(ccv_icf_compiled_cascade_t*) * count * multiscale_cascade[0]->count);
+	for (j = 0; j < count; j++)
+		for (k = 0; k < multiscale_cascade[j]->count; k++)
+			compiled[j * multiscale_cascade[0]->count + k] = _ccv_icf_compile_cascade(multiscale_cascade[j]->cascade + k);
+	_ccv_icf_compile_task_offsets(tasks, compiled, multiscale_cascade[0]->count, sats);
+	ccv_array_t** band_seq = (ccv_array_t**)cccalloc(ccv_max(tasks->rnum, 1), sizeof(ccv_array_t*));
+	parallel_for(n, tasks->rnum) {
+		ccv_icf_scan_task_t* task = (ccv_icf_scan_task_t*)ccv_array_get(tasks, n);
+		_ccv_icf_scan_multiscale_band(compiled[task->cascade * multiscale_cascade[0]->count + task->k], multiscale_cascade[task->cascade]->cascade[task->k].margin, sats[task->sat], margin, pyr[task->sat]->cols, params, task, band_seq + n);
+	} parallel_endfor
+	_ccv_icf_merge_bands(tasks, band_seq, seq);
+	ccfree(band_seq);
+	_ccv_icf_free_task_offsets(tasks);
+	ccv_array_free(tasks);
+	for (i = 0; i < count * multiscale_cascade[0]->count; i++)
+		ccfree(compiled[i]);
+	ccfree(compiled);
+	for (i = scale_from; i < scale_upto; i++)
+	{
+		ccv_matrix_free(sats[i]);
+		ccv_pyramid_release(pyramid, pyr[i]);
 	}
-
-	for (i = 1; i < scale_upto; i++)
-		ccv_matrix_free(pyr[i]);
 }
 
-ccv_array_t* ccv_icf_detect_objects(ccv_dense_matrix_t* a, void* cascade, int count, ccv_icf_param_t params)
+ccv_array_t* ccv_icf_detect_objects_in_pyramid(ccv_pyramid_t* pyramid, void* cascade, int count, ccv_icf_param_t params)
 {
 	assert(count > 0);
 	int i, j, k;
+	ccv_dense_matrix_t* a = pyramid->a;
+	if (params.roi.width > 0 && params.roi.height > 0)
+	{
+		/* only search inside the region of interest, with its own pyramid that the pyramid keeps for anyone else
+		 * searching the same region, and move what gets found there back into the image */
+		int x = ccv_max(params.roi.x, 0), y = ccv_max(params.roi.y, 0);
+		int cols = ccv_min(params.roi.x + params.roi.width, a->cols) - x;
+		int rows = ccv_min(params.roi.y + params.roi.height, a->rows) - y;
+		params.roi = ccv_rect(0, 0, 0, 0);
+		if (rows <= 0 || cols <= 0)
+			return ccv_array_new(sizeof(ccv_comp_t), 64, 0);
+		if (x > 0 || y > 0 || rows < a->rows || cols < a->cols)
+		{
+			ccv_pyramid_t* part = ccv_pyramid_slice(pyramid, x, y, rows, cols);
+			ccv_array_t* seq = ccv_icf_detect_objects_in_pyramid(part, cascade, count, params);
+			ccv_pyramid_release(pyramid, part->a);
+			for (i = 0; i < seq->rnum; i++)
+			{
+				ccv_comp_t* comp = (ccv_comp_t*)ccv_array_get(seq, i);
+				comp->rect.x += x;
+				comp->rect.y += y;
+			}
+			return seq;
+		}
+	}
 	int type = *(((int**)cascade)[0]);
 	for (i = 1; i < count; i++)
 	{
@@ -2174,10 +2950,10 @@ ccv_array_t* ccv_icf_detect_objects(ccv_dense_matrix_t* a, void* cascade, int co
 	switch (type)
 	{
 		case CCV_ICF_CLASSIFIER_TYPE_A:
-			_ccv_icf_detect_objects_with_classifier_cascade(a, (ccv_icf_classifier_cascade_t**)cascade, count, params, seq);
+			_ccv_icf_detect_objects_with_classifier_cascade(pyramid, (ccv_icf_classifier_cascade_t**)cascade, count, params, seq);
 			break;
 		case CCV_ICF_CLASSIFIER_TYPE_B:
-			_ccv_icf_detect_objects_with_multiscale_classifier_cascade(a, (ccv_icf_multiscale_classifier_cascade_t**)cascade, count, params, seq);
+			_ccv_icf_detect_objects_with_multiscale_classifier_cascade(pyramid, (ccv_icf_multiscale_classifier_cascade_t**)cascade, count, params, seq);
 			break;
 	}
 	ccv_array_t* result_seq = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
@@ -2196,7 +2972,7 @@ ccv_array_t* ccv_icf_detect_objects(ccv_dense_matrix_t* a, void* cascade, int co
 			ccv_array_t* idx_seq = 0;
 			ccv_array_clear(seq2);
 			// group retrieved rectangles in order to filter out noise
-			int ncomp = ccv_array_group(seq[k], &idx_seq, _ccv_is_equal_same_class, 0);
+			int ncomp = ccv_array_group_bounded(seq[k], &idx_seq, _ccv_is_equal_same_class, _ccv_is_equal_bound, 0);
 			ccv_comp_t* comps = (ccv_comp_t*)cccalloc(ncomp + 1, sizeof(ccv_comp_t));
 
 			// count number of neighbors
@@ -2286,3 +3062,12 @@ ccv_array_t* ccv_icf_detect_objects(ccv_dense_matrix_t* a, void* cascade, int co
 
 	return result_seq;
 }
+
+ccv_array_t* ccv_icf_detect_objects(ccv_dense_matrix_t* a, void* cascade, int count, ccv_icf_param_t params)
+{
+	ccv_pyramid_t* pyramid = ccv_pyramid_new(a);
+	pyramid->retain = 0;
+	ccv_array_t* seq = ccv_icf_detect_objects_in_pyramid(pyramid, cascade, count, params);
+	ccv_pyramid_free(pyramid);
+	return seq;
+}
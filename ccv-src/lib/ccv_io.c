@@ -33,7 +33,7 @@
 #include "io/_ccv_io_binary.inc"
 #include "io/_ccv_io_raw.inc"
 
-static int _ccv_read_and_close_fd(FILE* fd, ccv_dense_matrix_t** x, int type)
+static int _ccv_read_and_close_fd(FILE* fd, ccv_dense_matrix_t** x, int type, int rows, int cols)
 {
 	int ctype = (type & 0xF00) ? CCV_8U | ((type & 0xF00) >> 8) : 0;
 	if ((type & 0XFF) == CCV_IO_ANY_FILE)
@@ -49,16 +49,16 @@ static int _ccv_read_and_close_fd(FILE* fd, ccv_dense_matrix_t** x, int type)
 		else if (memcmp(sig, "CCVBINDM", 8) == 0)
 			type = CCV_IO_BINARY_FILE;
 		else {
-			printf("Unknown file signature in '%s'\n", sig);
-			exit(1); // XXX make exit/return gracefull later
-		};
+			fclose(fd);
+			return CCV_IO_UNKNOWN;
+		}
 		fseek(fd, 0, SEEK_SET);
 	}
 	switch (type & 0XFF)
 	{
 #ifdef HAVE_LIBJPEG
 		case CCV_IO_JPEG_FILE:
-			_ccv_read_jpeg_fd(fd, x, ctype);
+			_ccv_read_jpeg_fd(fd, x, ctype, rows, cols);
 			break;
 #endif
 #ifdef HAVE_LIBPNG
@@ -184,13 +184,14 @@ int ccv_read_impl(const void* in, ccv_dense_matrix_t** x, int type, int rows, in
 	FILE* fd = 0;
 	if (type & CCV_IO_ANY_FILE)
 	{
-		assert(rows == 0 && cols == 0 && scanline == 0);
+		assert(rows >= 0 && cols >= 0 && scanline == 0);
 		fd = fopen((const char*)in, "rb");
 		if (!fd)
 			return CCV_IO_ERROR;
-		return _ccv_read_and_close_fd(fd, x, type);
+		return _ccv_read_and_close_fd(fd, x, type, rows, cols);
 	} else if (type & CCV_IO_ANY_STREAM) {
-		assert(rows > 8 && cols == 0 && scanline == 0);
+		// rows is the size of the data, cols and scanline the size to shrink to fit in
+		assert(rows > 8 && cols >= 0 && scanline >= 0);
 		assert((type & 0xFF) != CCV_IO_DEFLATE_STREAM); // deflate stream (compressed stream) is not supported yet
 #if _XOPEN_SOURCE >= 700 || _POSIX_C_SOURCE >= 200809L || defined(__APPLE__) || defined(BSD)
 		// this is only supported by glibc
@@ -208,7 +209,7 @@ int ccv_read_impl(const void* in, ccv_dense_matrix_t** x, int type, int rows, in
 			return CCV_IO_ERROR;
 		// mimicking itself as a "file"
 		type = (type & ~0x10) | 0x20;
-		return _ccv_read_and_close_fd(fd, x, type);
+		return _ccv_read_and_close_fd(fd, x, type, cols, scanline);
 #endif
 	} else if (type & CCV_IO_ANY_RAW) {
 		return _ccv_read_raw(x, (void*)in /* it can be modifiable if it is NO_COPY mode */, type, rows, cols, scanline);
@@ -22,6 +22,10 @@ static __thread ccv_cache_t ccv_cache;
 /* option to enable/disable cache */
 static __thread int ccv_cache_opt = 0;
 
+/* how often a signature lookup was answered from the cache */
+static __thread uint64_t ccv_cache_hit = 0;
+static __thread uint64_t ccv_cache_miss = 0;
+
 ccv_dense_matrix_t* ccv_dense_matrix_new(int rows, int cols, int type, void* data, uint64_t sig)
 {
 	ccv_dense_matrix_t* mat;
@@ -32,10 +36,12 @@ ccv_dense_matrix_t* ccv_dense_matrix_new(int rows, int cols, int type, void* dat
 		if (mat)
 		{
 			assert(type == 0);
+			++ccv_cache_hit;
 			mat->type |= CCV_GARBAGE; // set the flag so the upper level function knows this is from recycle-bin
 			mat->refcount = 1;
 			return mat;
 		}
+		++ccv_cache_miss;
 	}
 	if (type & CCV_NO_DATA_ALLOC)
 	{
@@ -217,10 +223,12 @@ ccv_array_t* ccv_array_new(int rsize, int rnum, uint64_t sig)
 		if (array)
 		{
 			assert(type == 1);
+			++ccv_cache_hit;
 			array->type |= CCV_GARBAGE;
 			array->refcount = 1;
 			return array;
 		}
+		++ccv_cache_miss;
 	}
 	array = (ccv_array_t*)ccmalloc(sizeof(ccv_array_t));
 	array->sig = sig;
@@ -280,6 +288,9 @@ void ccv_disable_cache(void)
 
 void ccv_enable_cache(size_t size)
 {
+	// re-enabling only changes the bound, objects already cached are dropped rather than leaked
+	if (ccv_cache_opt)
+		ccv_cache_close(&ccv_cache);
 	ccv_cache_opt = 1;
 	ccv_cache_init(&ccv_cache, size, 2, ccv_matrix_free_immediately, ccv_array_free_immediately);
 }
@@ -289,6 +300,19 @@ void ccv_enable_default_cache(void)
 	ccv_enable_cache(CCV_DEFAULT_CACHE_SIZE);
 }
 
+ccv_cache_stat_t ccv_cache_stat(void)
+{
+	ccv_cache_stat_t stat = {
+		.enabled = ccv_cache_opt,
+		.up = ccv_cache_opt ? ccv_cache.up : 0,
+		.size = ccv_cache_opt ? ccv_cache.size : 0,
+		.rnum = ccv_cache_opt ? ccv_cache.rnum : 0,
+		.hit = ccv_cache_hit,
+		.miss = ccv_cache_miss,
+	};
+	return stat;
+}
+
 static uint8_t key_siphash[16] = "libccvky4siphash";
 
 uint64_t ccv_cache_generate_signature(const char* msg, int len, uint64_t sig_start, ...)
@@ -1,5 +1,39 @@
 #include "ccv.h"
 #include "ccv_internal.h"
+#if defined(HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#if defined(USE_OPENMP) || defined(USE_DISPATCH)
+/* outputs are resampled in bands of rows with about this many pixels each, in parallel */
+#define CCV_RESAMPLE_BAND_SIZE (0x10000)
+
+static inline int _ccv_resample_band_count(ccv_dense_matrix_t* b)
+{
+	return ccv_clamp(b->rows * b->cols / CCV_RESAMPLE_BAND_SIZE, 1, b->rows);
+}
+#else
+static inline int _ccv_resample_band_count(ccv_dense_matrix_t* b)
+{
+	return 1;
+}
+#endif
+
+#ifdef HAVE_SSE2
+/* low 32 bits of a 32-bit multiplication, SSE2 only has the 32x32->64 one */
+static inline __m128i _ccv_mullo_epi32(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
 
 /* area interpolation resample is adopted from OpenCV */
 
@@ -17,7 +51,7 @@ static void _ccv_resample_area_8u(ccv_dense_matrix_t* a, ccv_dense_matrix_t* b)
 	double scale_y = (double)a->rows / b->rows;
 	// double scale = 1.f / (scale_x * scale_y);
 	unsigned int inv_scale_256 = (int)(scale_x * scale_y * 0x10000);
-	int dx, dy, sx, sy, i, k;
+	int dx, sx, k;
 	for (dx = 0, k = 0; dx < b->cols; dx++)
 	{
 		double fsx1 = dx * scale_x, fsx2 = fsx1 + scale_x;
@@ -47,52 +81,92 @@ static void _ccv_resample_area_8u(ccv_dense_matrix_t* a, ccv_dense_matrix_t* b)
 		}
 	}
 	int xofs_count = k;
-	unsigned int* buf = (unsigned int*)alloca(b->cols * ch * sizeof(unsigned int));
-	unsigned int* sum = (unsigned int*)alloca(b->cols * ch * sizeof(unsigned int));
-	for (dx = 0; dx < b->cols * ch; dx++)
-		buf[dx] = sum[dx] = 0;
-	dy = 0;
-	for (sy = 0; sy < a->rows; sy++)
-	{
-		unsigned char* a_ptr = a->data.u8 + a->step * sy;
-		for (k = 0; k < xofs_count; k++)
-		{
-			int dxn = xofs[k].di;
-			unsigned int alpha = xofs[k].alpha;
-			for (i = 0; i < ch; i++)
-				buf[dxn + i] += a_ptr[xofs[k].si + i] * alpha;
-		}
-		if ((dy + 1) * scale_y <= sy + 1 || sy == a->rows - 1)
+	int band_count = _ccv_resample_band_count(b);
+	parallel_for(band, band_count) {
+		int dx, dy, sy, i, k;
+		int dy0 = band * b->rows / band_count;
+		int dy1 = (band + 1) * b->rows / band_count;
+		unsigned int* buf = (unsigned int*)ccmalloc(b->cols * ch * sizeof(unsigned int) * 2);
+		unsigned int* sum = buf + b->cols * ch;
+		for (dx = 0; dx < b->cols * ch; dx++)
+			buf[dx] = sum[dx] = 0;
+		/* a band other than the first starts at the source row that completes the row before it, so that
+		 * it carries over the same part of that source row as a single pass over the whole image does */
+		dy = ccv_max(dy0 - 1, 0);
+		sy = 0;
+		if (dy0 > 0)
+			for (sy = ccv_max((int)(dy0 * scale_y) - 2, 0); sy < a->rows - 1 && !((dy + 1) * scale_y <= sy + 1); sy++);
+		for (; sy < a->rows && dy < dy1; sy++)
 		{
-			unsigned int beta = (int)(ccv_max(sy + 1 - (dy + 1) * scale_y, 0.f) * 256);
-			unsigned int beta1 = 256 - beta;
-			unsigned char* b_ptr = b->data.u8 + b->step * dy;
-			if (beta <= 0)
+			unsigned char* a_ptr = a->data.u8 + a->step * sy;
+			for (k = 0; k < xofs_count; k++)
 			{
-				for (dx = 0; dx < b->cols * ch; dx++)
+				int dxn = xofs[k].di;
+				unsigned int alpha = xofs[k].alpha;
+				for (i = 0; i < ch; i++)
+					buf[dxn + i] += a_ptr[xofs[k].si + i] * alpha;
+			}
+			if ((dy + 1) * scale_y <= sy + 1 || sy == a->rows - 1)
+			{
+				unsigned int beta = (int)(ccv_max(sy + 1 - (dy + 1) * scale_y, 0.f) * 256);
+				unsigned int beta1 = 256 - beta;
+				dx = 0;
+				if (dy < dy0)
 				{
-					b_ptr[dx] = ccv_clamp((sum[dx] + buf[dx] * 256) / inv_scale_256, 0, 255);
-					sum[dx] = buf[dx] = 0;
+					for (; dx < b->cols * ch; dx++)
+					{
+						sum[dx] = buf[dx] * beta;
+						buf[dx] = 0;
+					}
+				} else {
+					unsigned char* b_ptr = b->data.u8 + b->step * dy;
+#ifdef HAVE_SSE2
+					/* the quotients are below 2^16 and at least 2^-24 away from the next integer unless they are one,
+					 * so truncating them in double precision gives the same as the integer division */
+					__m128i beta14 = _mm_set1_epi32(beta1);
+					__m128i beta4 = _mm_set1_epi32(beta);
+					__m128i sign4 = _mm_set1_epi32(0x80000000);
+					__m128d sign2 = _mm_set1_pd(2147483648.0);
+					__m128d inv_scale2 = _mm_set1_pd((double)inv_scale_256);
+					__m128i zero4 = _mm_setzero_si128();
+					for (; dx < b->cols * ch - 3; dx += 4)
+					{
+						__m128i buf4 = _mm_loadu_si128((__m128i*)(buf + dx));
+						__m128i n4 = _mm_xor_si128(_mm_add_epi32(_mm_loadu_si128((__m128i*)(sum + dx)), _ccv_mullo_epi32(buf4, beta14)), sign4);
+						__m128i q0 = _mm_cvttpd_epi32(_mm_div_pd(_mm_add_pd(_mm_cvtepi32_pd(n4), sign2), inv_scale2));
+						__m128i q1 = _mm_cvttpd_epi32(_mm_div_pd(_mm_add_pd(_mm_cvtepi32_pd(_mm_srli_si128(n4, 8)), sign2), inv_scale2));
+						__m128i q4 = _mm_packs_epi32(_mm_unpacklo_epi64(q0, q1), zero4);
+						*(int*)(b_ptr + dx) = _mm_cvtsi128_si32(_mm_packus_epi16(q4, q4));
+						_mm_storeu_si128((__m128i*)(sum + dx), _ccv_mullo_epi32(buf4, beta4));
+						_mm_storeu_si128((__m128i*)(buf + dx), zero4);
+					}
+#endif
+					for (; dx < b->cols * ch; dx++)
+					{
+						b_ptr[dx] = ccv_clamp((sum[dx] + buf[dx] * beta1) / inv_scale_256, 0, 255);
+						sum[dx] = buf[dx] * beta;
+						buf[dx] = 0;
+					}
 				}
+				dy++;
 			} else {
-				for (dx = 0; dx < b->cols * ch; dx++)
+				dx = 0;
+#ifdef HAVE_SSE2
+				for (; dx < b->cols * ch - 3; dx += 4)
+				{
+					_mm_storeu_si128((__m128i*)(sum + dx), _mm_add_epi32(_mm_loadu_si128((__m128i*)(sum + dx)), _mm_slli_epi32(_mm_loadu_si128((__m128i*)(buf + dx)), 8)));
+					_mm_storeu_si128((__m128i*)(buf + dx), _mm_setzero_si128());
+				}
+#endif
+				for (; dx < b->cols * ch; dx++)
 				{
-					b_ptr[dx] = ccv_clamp((sum[dx] + buf[dx] * beta1) / inv_scale_256, 0, 255);
-					sum[dx] = buf[dx] * beta;
+					sum[dx] += buf[dx] * 256;
 					buf[dx] = 0;
 				}
 			}
-			dy++;
 		}
-		else
-		{
-			for(dx = 0; dx < b->cols * ch; dx++)
-			{
-				sum[dx] += buf[dx] * 256;
-				buf[dx] = 0;
-			}
-		}
-	}
+		ccfree(buf);
+	} parallel_endfor
 }
 
 typedef struct {
@@ -213,10 +287,32 @@ static void _ccv_init_cubic_coeffs(int si, int sz, float s, ccv_cubic_coeffs_t*
 	coeff->coeffs[3] = 1.f - coeff->coeffs[0] - coeff->coeffs[1] - coeff->coeffs[2];
 }
 
+/* the vertical pass for 32F outputs, four at a time in the same order of operations, returns how many are done */
+static inline int _ccv_resample_cubic_float_vertical(int type, unsigned char** row, const float* coeffs, unsigned char* b_ptr, int count)
+{
+	int j = 0;
+#ifdef HAVE_SSE2
+	if (CCV_GET_DATA_TYPE(type) != CCV_32F)
+		return 0;
+	__m128 c0 = _mm_set1_ps(coeffs[0]);
+	__m128 c1 = _mm_set1_ps(coeffs[1]);
+	__m128 c2 = _mm_set1_ps(coeffs[2]);
+	__m128 c3 = _mm_set1_ps(coeffs[3]);
+	for (; j < count - 3; j += 4)
+	{
+		__m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps((float*)row[0] + j), c0), _mm_mul_ps(_mm_loadu_ps((float*)row[1] + j), c1));
+		v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps((float*)row[2] + j), c2));
+		v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps((float*)row[3] + j), c3));
+		_mm_storeu_ps((float*)b_ptr + j, v);
+	}
+#endif
+	return j;
+}
+
 static void _ccv_resample_cubic_float_only(ccv_dense_matrix_t* a, ccv_dense_matrix_t* b)
 {
 	assert(CCV_GET_DATA_TYPE(b->type) == CCV_32F || CCV_GET_DATA_TYPE(b->type) == CCV_64F);
-	int i, j, k, ch = CCV_GET_CHANNEL(a->type);
+	int i, ch = CCV_GET_CHANNEL(a->type);
 	assert(b->cols > 0 && b->step > 0);
 	ccv_cubic_coeffs_t* xofs = (ccv_cubic_coeffs_t*)alloca(sizeof(ccv_cubic_coeffs_t) * b->cols);
 	float scale_x = (float)a->cols / b->cols;
@@ -226,47 +322,57 @@ static void _ccv_resample_cubic_float_only(ccv_dense_matrix_t* a, ccv_dense_matr
 		_ccv_init_cubic_coeffs((int)sx, a->cols, sx, xofs + i);
 	}
 	float scale_y = (float)a->rows / b->rows;
-	unsigned char* buf = (unsigned char*)alloca(b->step * 4);
+	int band_count = _ccv_resample_band_count(b);
+	parallel_for(band, band_count) {
+		int i, j, k;
+		int i0 = band * b->rows / band_count;
+		int i1 = (band + 1) * b->rows / band_count;
+		unsigned char* buf = (unsigned char*)ccmalloc(b->step * 4);
 #ifdef __clang_analyzer__
-	memset(buf, 0, b->step * 4);
+		memset(buf, 0, b->step * 4);
 #endif
-	unsigned char* a_ptr = a->data.u8;
-	unsigned char* b_ptr = b->data.u8;
-	int psi = -1, siy = 0;
+		unsigned char* a_ptr = a->data.u8;
+		unsigned char* b_ptr = b->data.u8 + b->step * i0;
+		int psi = -1, siy = 0;
 #define for_block(_for_get, _for_set_b, _for_get_b) \
-	for (i = 0; i < b->rows; i++) \
-	{ \
-		ccv_cubic_coeffs_t yofs; \
-		float sy = (i + 0.5) * scale_y - 0.5; \
-		_ccv_init_cubic_coeffs((int)sy, a->rows, sy, &yofs); \
-		if (yofs.si[3] > psi) \
+		for (i = i0; i < i1; i++) \
 		{ \
-			for (; siy <= yofs.si[3]; siy++) \
+			ccv_cubic_coeffs_t yofs; \
+			float sy = (i + 0.5) * scale_y - 0.5; \
+			_ccv_init_cubic_coeffs((int)sy, a->rows, sy, &yofs); \
+			if (yofs.si[3] > psi) \
 			{ \
-				unsigned char* row = buf + (siy & 0x3) * b->step; \
-				for (j = 0; j < b->cols; j++) \
-					for (k = 0; k < ch; k++) \
-						_for_set_b(row, j * ch + k, _for_get(a_ptr, xofs[j].si[0] * ch + k, 0) * xofs[j].coeffs[0] + \
-													_for_get(a_ptr, xofs[j].si[1] * ch + k, 0) * xofs[j].coeffs[1] + \
-													_for_get(a_ptr, xofs[j].si[2] * ch + k, 0) * xofs[j].coeffs[2] + \
-													_for_get(a_ptr, xofs[j].si[3] * ch + k, 0) * xofs[j].coeffs[3], 0); \
-				a_ptr += a->step; \
+				/* rows that no output row needs are skipped, which the first row of a band does for those of the bands before */ \
+				siy = ccv_max(siy, yofs.si[0]); \
+				a_ptr = a->data.u8 + a->step * siy; \
+				for (; siy <= yofs.si[3]; siy++) \
+				{ \
+					unsigned char* row = buf + (siy & 0x3) * b->step; \
+					for (j = 0; j < b->cols; j++) \
+						for (k = 0; k < ch; k++) \
+							_for_set_b(row, j * ch + k, _for_get(a_ptr, xofs[j].si[0] * ch + k, 0) * xofs[j].coeffs[0] + \
+														_for_get(a_ptr, xofs[j].si[1] * ch + k, 0) * xofs[j].coeffs[1] + \
+														_for_get(a_ptr, xofs[j].si[2] * ch + k, 0) * xofs[j].coeffs[2] + \
+														_for_get(a_ptr, xofs[j].si[3] * ch + k, 0) * xofs[j].coeffs[3], 0); \
+					a_ptr += a->step; \
+				} \
+				psi = yofs.si[3]; \
 			} \
-			psi = yofs.si[3]; \
-		} \
-		unsigned char* row[4] = { \
-			buf + (yofs.si[0] & 0x3) * b->step, \
-			buf + (yofs.si[1] & 0x3) * b->step, \
-			buf + (yofs.si[2] & 0x3) * b->step, \
-			buf + (yofs.si[3] & 0x3) * b->step, \
-		}; \
-		for (j = 0; j < b->cols * ch; j++) \
-			_for_set_b(b_ptr, j, _for_get_b(row[0], j, 0) * yofs.coeffs[0] + _for_get_b(row[1], j, 0) * yofs.coeffs[1] + \
-								 _for_get_b(row[2], j, 0) * yofs.coeffs[2] + _for_get_b(row[3], j, 0) * yofs.coeffs[3], 0); \
-		b_ptr += b->step; \
-	}
-	ccv_matrix_getter(a->type, ccv_matrix_setter_getter_float_only, b->type, for_block);
+			unsigned char* row[4] = { \
+				buf + (yofs.si[0] & 0x3) * b->step, \
+				buf + (yofs.si[1] & 0x3) * b->step, \
+				buf + (yofs.si[2] & 0x3) * b->step, \
+				buf + (yofs.si[3] & 0x3) * b->step, \
+			}; \
+			for (j = _ccv_resample_cubic_float_vertical(b->type, row, yofs.coeffs, b_ptr, b->cols * ch); j < b->cols * ch; j++) \
+				_for_set_b(b_ptr, j, _for_get_b(row[0], j, 0) * yofs.coeffs[0] + _for_get_b(row[1], j, 0) * yofs.coeffs[1] + \
+									 _for_get_b(row[2], j, 0) * yofs.coeffs[2] + _for_get_b(row[3], j, 0) * yofs.coeffs[3], 0); \
+			b_ptr += b->step; \
+		}
+		ccv_matrix_getter(a->type, ccv_matrix_setter_getter_float_only, b->type, for_block);
 #undef for_block
+		ccfree(buf);
+	} parallel_endfor
 }
 
 static void _ccv_init_cubic_integer_coeffs(int si, int sz, float s, ccv_cubic_integer_coeffs_t* coeff)
@@ -284,10 +390,39 @@ static void _ccv_init_cubic_integer_coeffs(int si, int sz, float s, ccv_cubic_in
 	coeff->coeffs[3] = W_BITS - coeff->coeffs[0] - coeff->coeffs[1] - coeff->coeffs[2];
 }
 
+/* the vertical pass for 8U and 32S outputs, four at a time, returns how many are done */
+static inline int _ccv_resample_cubic_integer_vertical(int type, unsigned char** row, const int* coeffs, unsigned char* b_ptr, int count)
+{
+	int j = 0;
+#ifdef HAVE_SSE2
+	if (CCV_GET_DATA_TYPE(type) != CCV_8U && CCV_GET_DATA_TYPE(type) != CCV_32S)
+		return 0;
+	__m128i c0 = _mm_set1_epi32(coeffs[0]);
+	__m128i c1 = _mm_set1_epi32(coeffs[1]);
+	__m128i c2 = _mm_set1_epi32(coeffs[2]);
+	__m128i c3 = _mm_set1_epi32(coeffs[3]);
+	__m128i half = _mm_set1_epi32(1 << 11);
+	for (; j < count - 3; j += 4)
+	{
+		__m128i v = _mm_add_epi32(_ccv_mullo_epi32(_mm_loadu_si128((__m128i*)((int*)row[0] + j)), c0), _ccv_mullo_epi32(_mm_loadu_si128((__m128i*)((int*)row[1] + j)), c1));
+		v = _mm_add_epi32(v, _ccv_mullo_epi32(_mm_loadu_si128((__m128i*)((int*)row[2] + j)), c2));
+		v = _mm_add_epi32(v, _ccv_mullo_epi32(_mm_loadu_si128((__m128i*)((int*)row[3] + j)), c3));
+		v = _mm_srai_epi32(_mm_add_epi32(v, half), 12);
+		if (CCV_GET_DATA_TYPE(type) == CCV_8U)
+		{
+			v = _mm_packs_epi32(v, v);
+			*(int*)(b_ptr + j) = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+		} else
+			_mm_storeu_si128((__m128i*)((int*)b_ptr + j), v);
+	}
+#endif
+	return j;
+}
+
 static void _ccv_resample_cubic_integer_only(ccv_dense_matrix_t* a, ccv_dense_matrix_t* b)
 {
 	assert(CCV_GET_DATA_TYPE(b->type) == CCV_8U || CCV_GET_DATA_TYPE(b->type) == CCV_32S || CCV_GET_DATA_TYPE(b->type) == CCV_64S);
-	int i, j, k, ch = CCV_GET_CHANNEL(a->type);
+	int i, ch = CCV_GET_CHANNEL(a->type);
 	int no_8u_type = (b->type & CCV_8U) ? CCV_32S : b->type;
 	assert(b->cols > 0);
 	ccv_cubic_integer_coeffs_t* xofs = (ccv_cubic_integer_coeffs_t*)alloca(sizeof(ccv_cubic_integer_coeffs_t) * b->cols);
@@ -299,47 +434,56 @@ static void _ccv_resample_cubic_integer_only(ccv_dense_matrix_t* a, ccv_dense_ma
 	}
 	float scale_y = (float)a->rows / b->rows;
 	int bufstep = b->cols * ch * CCV_GET_DATA_TYPE_SIZE(no_8u_type);
-	unsigned char* buf = (unsigned char*)alloca(bufstep * 4);
+	int band_count = _ccv_resample_band_count(b);
+	parallel_for(band, band_count) {
+		int i, j, k;
+		int i0 = band * b->rows / band_count;
+		int i1 = (band + 1) * b->rows / band_count;
+		unsigned char* buf = (unsigned char*)ccmalloc(bufstep * 4);
 #ifdef __clang_analyzer__
-	memset(buf, 0, bufstep * 4);
+		memset(buf, 0, bufstep * 4);
 #endif
-	unsigned char* a_ptr = a->data.u8;
-	unsigned char* b_ptr = b->data.u8;
-	int psi = -1, siy = 0;
+		unsigned char* a_ptr = a->data.u8;
+		unsigned char* b_ptr = b->data.u8 + b->step * i0;
+		int psi = -1, siy = 0;
 #define for_block(_for_get_a, _for_set, _for_get, _for_set_b) \
-	for (i = 0; i < b->rows; i++) \
-	{ \
-		ccv_cubic_integer_coeffs_t yofs; \
-		float sy = (i + 0.5) * scale_y - 0.5; \
-		_ccv_init_cubic_integer_coeffs((int)sy, a->rows, sy, &yofs); \
-		if (yofs.si[3] > psi) \
+		for (i = i0; i < i1; i++) \
 		{ \
-			for (; siy <= yofs.si[3]; siy++) \
+			ccv_cubic_integer_coeffs_t yofs; \
+			float sy = (i + 0.5) * scale_y - 0.5; \
+			_ccv_init_cubic_integer_coeffs((int)sy, a->rows, sy, &yofs); \
+			if (yofs.si[3] > psi) \
 			{ \
-				unsigned char* row = buf + (siy & 0x3) * bufstep; \
-				for (j = 0; j < b->cols; j++) \
-					for (k = 0; k < ch; k++) \
-						_for_set(row, j * ch + k, _for_get_a(a_ptr, xofs[j].si[0] * ch + k, 0) * xofs[j].coeffs[0] + \
-												  _for_get_a(a_ptr, xofs[j].si[1] * ch + k, 0) * xofs[j].coeffs[1] + \
-												  _for_get_a(a_ptr, xofs[j].si[2] * ch + k, 0) * xofs[j].coeffs[2] + \
-												  _for_get_a(a_ptr, xofs[j].si[3] * ch + k, 0) * xofs[j].coeffs[3], 0); \
-				a_ptr += a->step; \
+				siy = ccv_max(siy, yofs.si[0]); \
+				a_ptr = a->data.u8 + a->step * siy; \
+				for (; siy <= yofs.si[3]; siy++) \
+				{ \
+					unsigned char* row = buf + (siy & 0x3) * bufstep; \
+					for (j = 0; j < b->cols; j++) \
+						for (k = 0; k < ch; k++) \
+							_for_set(row, j * ch + k, _for_get_a(a_ptr, xofs[j].si[0] * ch + k, 0) * xofs[j].coeffs[0] + \
+													  _for_get_a(a_ptr, xofs[j].si[1] * ch + k, 0) * xofs[j].coeffs[1] + \
+													  _for_get_a(a_ptr, xofs[j].si[2] * ch + k, 0) * xofs[j].coeffs[2] + \
+													  _for_get_a(a_ptr, xofs[j].si[3] * ch + k, 0) * xofs[j].coeffs[3], 0); \
+					a_ptr += a->step; \
+				} \
+				psi = yofs.si[3]; \
 			} \
-			psi = yofs.si[3]; \
-		} \
-		unsigned char* row[4] = { \
-			buf + (yofs.si[0] & 0x3) * bufstep, \
-			buf + (yofs.si[1] & 0x3) * bufstep, \
-			buf + (yofs.si[2] & 0x3) * bufstep, \
-			buf + (yofs.si[3] & 0x3) * bufstep, \
-		}; \
-		for (j = 0; j < b->cols * ch; j++) \
-			_for_set_b(b_ptr, j, ccv_descale(_for_get(row[0], j, 0) * yofs.coeffs[0] + _for_get(row[1], j, 0) * yofs.coeffs[1] + \
-											 _for_get(row[2], j, 0) * yofs.coeffs[2] + _for_get(row[3], j, 0) * yofs.coeffs[3], 12), 0); \
-		b_ptr += b->step; \
-	}
-	ccv_matrix_getter(a->type, ccv_matrix_setter_getter_integer_only, no_8u_type, ccv_matrix_setter_integer_only, b->type, for_block);
+			unsigned char* row[4] = { \
+				buf + (yofs.si[0] & 0x3) * bufstep, \
+				buf + (yofs.si[1] & 0x3) * bufstep, \
+				buf + (yofs.si[2] & 0x3) * bufstep, \
+				buf + (yofs.si[3] & 0x3) * bufstep, \
+			}; \
+			for (j = (CCV_GET_DATA_TYPE(no_8u_type) == CCV_32S) ? _ccv_resample_cubic_integer_vertical(b->type, row, yofs.coeffs, b_ptr, b->cols * ch) : 0; j < b->cols * ch; j++) \
+				_for_set_b(b_ptr, j, ccv_descale(_for_get(row[0], j, 0) * yofs.coeffs[0] + _for_get(row[1], j, 0) * yofs.coeffs[1] + \
+												 _for_get(row[2], j, 0) * yofs.coeffs[2] + _for_get(row[3], j, 0) * yofs.coeffs[3], 12), 0); \
+			b_ptr += b->step; \
+		}
+		ccv_matrix_getter(a->type, ccv_matrix_setter_getter_integer_only, no_8u_type, ccv_matrix_setter_integer_only, b->type, for_block);
 #undef for_block
+		ccfree(buf);
+	} parallel_endfor
 }
 
 void ccv_resample(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int btype, int rows, int cols, int type)
@@ -377,6 +521,90 @@ void ccv_resample(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int btype, int
 	}
 }
 
+/* the horizontal pass of ccv_sample_down for single channel 8U and 32F, as many columns at a time as fit
+ * while all five taps stay inside the row, returns the column the plain loop continues from */
+static inline int _ccv_sample_down_horizontal(int type, int ch, unsigned char* a_ptr, int sx, int a_cols, unsigned char* row, int dx, int end)
+{
+#ifdef HAVE_SSE2
+	if (ch != 1)
+		return dx;
+	if (CCV_GET_DATA_TYPE(type) == CCV_8U)
+	{
+		__m128i mask = _mm_set1_epi16(0xff);
+		__m128i z = _mm_setzero_si128();
+		/* the even and the odd bytes from three loads two apart are the five taps of eight outputs */
+		for (; dx + 8 <= end && dx * 2 + sx + 17 < a_cols; dx += 8)
+		{
+			unsigned char* p = a_ptr + dx * 2 + sx - 2;
+			__m128i v0 = _mm_loadu_si128((__m128i*)p);
+			__m128i v2 = _mm_loadu_si128((__m128i*)(p + 2));
+			__m128i v4 = _mm_loadu_si128((__m128i*)(p + 4));
+			__m128i e2 = _mm_and_si128(v2, mask);
+			__m128i s = _mm_add_epi16(_mm_and_si128(v0, mask), _mm_and_si128(v4, mask));
+			s = _mm_add_epi16(s, _mm_slli_epi16(_mm_add_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v2, 8)), 2));
+			s = _mm_add_epi16(s, _mm_add_epi16(_mm_slli_epi16(e2, 2), _mm_slli_epi16(e2, 1)));
+			_mm_storeu_si128((__m128i*)((int*)row + dx), _mm_unpacklo_epi16(s, z));
+			_mm_storeu_si128((__m128i*)((int*)row + dx + 4), _mm_unpackhi_epi16(s, z));
+		}
+	} else if (CCV_GET_DATA_TYPE(type) == CCV_32F) {
+		__m128 six = _mm_set1_ps(6);
+		__m128 four = _mm_set1_ps(4);
+		for (; dx + 4 <= end && dx * 2 + sx + 9 < a_cols; dx += 4)
+		{
+			float* p = (float*)a_ptr + dx * 2 + sx - 2;
+			__m128 l0 = _mm_loadu_ps(p), l4 = _mm_loadu_ps(p + 4);
+			__m128 l2 = _mm_loadu_ps(p + 2), l6 = _mm_loadu_ps(p + 6);
+			__m128 l8 = _mm_loadu_ps(p + 8);
+			__m128 m2 = _mm_shuffle_ps(l0, l4, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 m1 = _mm_shuffle_ps(l0, l4, _MM_SHUFFLE(3, 1, 3, 1));
+			__m128 c = _mm_shuffle_ps(l2, l6, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 p1 = _mm_shuffle_ps(l2, l6, _MM_SHUFFLE(3, 1, 3, 1));
+			__m128 p2 = _mm_shuffle_ps(l4, l8, _MM_SHUFFLE(2, 0, 2, 0));
+			/* in the same order of operations as the plain loop */
+			__m128 s = _mm_add_ps(_mm_mul_ps(c, six), _mm_mul_ps(_mm_add_ps(m1, p1), four));
+			_mm_storeu_ps((float*)row + dx, _mm_add_ps(_mm_add_ps(s, m2), p2));
+		}
+	}
+#endif
+	return dx;
+}
+
+/* the vertical pass of ccv_sample_down from 8U to 8U and from 32F to 32F, returns how many outputs are done */
+static inline int _ccv_sample_down_vertical(int type, int btype, unsigned char** rows, unsigned char* b_ptr, int count)
+{
+	int dx = 0;
+#ifdef HAVE_SSE2
+	if (CCV_GET_DATA_TYPE(type) == CCV_8U && CCV_GET_DATA_TYPE(btype) == CCV_8U)
+	{
+		int i;
+		for (; dx < count - 7; dx += 8)
+		{
+			__m128i s[2];
+			for (i = 0; i < 2; i++)
+			{
+				__m128i r2 = _mm_loadu_si128((__m128i*)((int*)rows[2] + dx + i * 4));
+				__m128i r13 = _mm_add_epi32(_mm_loadu_si128((__m128i*)((int*)rows[1] + dx + i * 4)), _mm_loadu_si128((__m128i*)((int*)rows[3] + dx + i * 4)));
+				__m128i r04 = _mm_add_epi32(_mm_loadu_si128((__m128i*)((int*)rows[0] + dx + i * 4)), _mm_loadu_si128((__m128i*)((int*)rows[4] + dx + i * 4)));
+				/* the sums are never negative, so the shift is the division */
+				s[i] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(r2, 2), _mm_slli_epi32(r2, 1)), _mm_add_epi32(_mm_slli_epi32(r13, 2), r04)), 8);
+			}
+			_mm_storel_epi64((__m128i*)(b_ptr + dx), _mm_packus_epi16(_mm_packs_epi32(s[0], s[1]), s[0]));
+		}
+	} else if (CCV_GET_DATA_TYPE(type) == CCV_32F && CCV_GET_DATA_TYPE(btype) == CCV_32F) {
+		__m128 six = _mm_set1_ps(6);
+		__m128 four = _mm_set1_ps(4);
+		__m128 scale = _mm_set1_ps(1.0 / 256);
+		for (; dx < count - 3; dx += 4)
+		{
+			__m128 s = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps((float*)rows[2] + dx), six), _mm_mul_ps(_mm_add_ps(_mm_loadu_ps((float*)rows[1] + dx), _mm_loadu_ps((float*)rows[3] + dx)), four));
+			s = _mm_add_ps(_mm_add_ps(s, _mm_loadu_ps((float*)rows[0] + dx)), _mm_loadu_ps((float*)rows[4] + dx));
+			_mm_storeu_ps((float*)b_ptr + dx, _mm_mul_ps(s, scale));
+		}
+	}
+#endif
+	return dx;
+}
+
 /* the following code is adopted from OpenCV cvPyrDown */
 void ccv_sample_down(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, int src_x, int src_y)
 {
@@ -387,17 +615,12 @@ void ccv_sample_down(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, in
 	ccv_object_return_if_cached(, db);
 	int ch = CCV_GET_CHANNEL(a->type);
 	int cols0 = db->cols - 1 - src_x;
-	int dy, sy = -2 + src_y, sx = src_x * ch, dx, k;
+	int sx = src_x * ch, i, j;
 	int* tab = (int*)alloca((a->cols + src_x + 2) * ch * sizeof(int));
-	for (dx = 0; dx < a->cols + src_x + 2; dx++)
-		for (k = 0; k < ch; k++)
-			tab[dx * ch + k] = ((dx >= a->cols) ? a->cols * 2 - 1 - dx : dx) * ch + k;
-	unsigned char* buf = (unsigned char*)alloca(5 * db->cols * ch * ccv_max(CCV_GET_DATA_TYPE_SIZE(db->type), sizeof(int)));
+	for (i = 0; i < a->cols + src_x + 2; i++)
+		for (j = 0; j < ch; j++)
+			tab[i * ch + j] = ((i >= a->cols) ? a->cols * 2 - 1 - i : i) * ch + j;
 	int bufstep = db->cols * ch * ccv_max(CCV_GET_DATA_TYPE_SIZE(db->type), sizeof(int));
-#ifdef __clang_analyzer__
-	memset(buf, 0, 5 * bufstep);
-#endif
-	unsigned char* b_ptr = db->data.u8;
 	/* why is src_y * 4 in computing the offset of row?
 	 * Essentially, it means sy - src_y but in a manner that doesn't result negative number.
 	 * notice that we added src_y before when computing sy in the first place, however,
@@ -405,7 +628,7 @@ void ccv_sample_down(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, in
 	 * because in later rearrangement, we have no src_y to backup the arrangement). In
 	 * such micro scope, we managed to stripe 5 addition into one shift and addition. */
 #define for_block(_for_get_a, _for_set, _for_get, _for_set_b) \
-	for (dy = 0; dy < db->rows; dy++) \
+	for (dy = dy0; dy < dy1; dy++) \
 	{ \
 		for(; sy <= dy * 2 + 2 + src_y; sy++) \
 		{ \
@@ -414,7 +637,7 @@ void ccv_sample_down(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, in
 			unsigned char* a_ptr = a->data.u8 + a->step * _sy; \
 			for (k = 0; k < ch; k++) \
 				_for_set(row, k, _for_get_a(a_ptr, sx + k, 0) * 10 + _for_get_a(a_ptr, ch + sx + k, 0) * 5 + _for_get_a(a_ptr, 2 * ch + sx + k, 0), 0); \
-			for(dx = ch; dx < cols0 * ch; dx += ch) \
+			for (dx = _ccv_sample_down_horizontal(a->type, ch, a_ptr, sx, a->cols, row, ch, cols0 * ch); dx < cols0 * ch; dx += ch) \
 				for (k = 0; k < ch; k++) \
 					_for_set(row, dx + k, _for_get_a(a_ptr, dx * 2 + sx + k, 0) * 6 + (_for_get_a(a_ptr, dx * 2 + sx + k - ch, 0) + _for_get_a(a_ptr, dx * 2 + sx + k + ch, 0)) * 4 + _for_get_a(a_ptr, dx * 2 + sx + k - ch * 2, 0) + _for_get_a(a_ptr, dx * 2 + sx + k + ch * 2, 0), 0); \
 			x_block(_for_get_a, _for_set, _for_get, _for_set_b); \
@@ -422,29 +645,130 @@ void ccv_sample_down(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, in
 		unsigned char* rows[5]; \
 		for(k = 0; k < 5; k++) \
 			rows[k] = buf + ((dy * 2 + k) % 5) * bufstep; \
-		for(dx = 0; dx < db->cols * ch; dx++) \
+		for (dx = _ccv_sample_down_vertical(a->type, db->type, rows, b_ptr, db->cols * ch); dx < db->cols * ch; dx++) \
 			_for_set_b(b_ptr, dx, (_for_get(rows[2], dx, 0) * 6 + (_for_get(rows[1], dx, 0) + _for_get(rows[3], dx, 0)) * 4 + _for_get(rows[0], dx, 0) + _for_get(rows[4], dx, 0)) / 256, 0); \
 		b_ptr += db->step; \
 	}
 	int no_8u_type = (a->type & CCV_8U) ? CCV_32S : a->type;
-	if (src_x > 0)
-	{
+	/* a band of output rows fills its own 5-row buffer from the two source rows above its first row on,
+	 * the slots only depend on the source row, so it lines up the same as a single pass does */
+	int band_count = _ccv_resample_band_count(db);
+	parallel_for(band, band_count) {
+		int dx, dy, k;
+		int dy0 = band * db->rows / band_count;
+		int dy1 = (band + 1) * db->rows / band_count;
+		int sy = dy0 * 2 - 2 + src_y;
+		unsigned char* buf = (unsigned char*)ccmalloc(5 * bufstep);
+#ifdef __clang_analyzer__
+		memset(buf, 0, 5 * bufstep);
+#endif
+		unsigned char* b_ptr = db->data.u8 + db->step * dy0;
+		if (src_x > 0)
+		{
 #define x_block(_for_get_a, _for_set, _for_get, _for_set_b) \
-		for (dx = cols0 * ch; dx < db->cols * ch; dx += ch) \
-			for (k = 0; k < ch; k++) \
-				_for_set(row, dx + k, _for_get_a(a_ptr, tab[dx * 2 + sx + k], 0) * 6 + (_for_get_a(a_ptr, tab[dx * 2 + sx + k - ch], 0) + _for_get_a(a_ptr, tab[dx * 2 + sx + k + ch], 0)) * 4 + _for_get_a(a_ptr, tab[dx * 2 + sx + k - ch * 2], 0) + _for_get_a(a_ptr, tab[dx * 2 + sx + k + ch * 2], 0), 0);
-		ccv_matrix_getter_a(a->type, ccv_matrix_setter_getter, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
+			for (dx = cols0 * ch; dx < db->cols * ch; dx += ch) \
+				for (k = 0; k < ch; k++) \
+					_for_set(row, dx + k, _for_get_a(a_ptr, tab[dx * 2 + sx + k], 0) * 6 + (_for_get_a(a_ptr, tab[dx * 2 + sx + k - ch], 0) + _for_get_a(a_ptr, tab[dx * 2 + sx + k + ch], 0)) * 4 + _for_get_a(a_ptr, tab[dx * 2 + sx + k - ch * 2], 0) + _for_get_a(a_ptr, tab[dx * 2 + sx + k + ch * 2], 0), 0);
+			ccv_matrix_getter_a(a->type, ccv_matrix_setter_getter, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
 #undef x_block
-	} else {
+		} else {
 #define x_block(_for_get_a, _for_set, _for_get, _for_set_b) \
-		for (k = 0; k < ch; k++) \
-			_for_set(row, (db->cols - 1) * ch + k, _for_get_a(a_ptr, a->cols * ch + sx - ch + k, 0) * 10 + _for_get_a(a_ptr, (a->cols - 2) * ch + sx + k, 0) * 5 + _for_get_a(a_ptr, (a->cols - 3) * ch + sx + k, 0), 0);
-		ccv_matrix_getter_a(a->type, ccv_matrix_setter_getter, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
+			for (k = 0; k < ch; k++) \
+				_for_set(row, (db->cols - 1) * ch + k, _for_get_a(a_ptr, a->cols * ch + sx - ch + k, 0) * 10 + _for_get_a(a_ptr, (a->cols - 2) * ch + sx + k, 0) * 5 + _for_get_a(a_ptr, (a->cols - 3) * ch + sx + k, 0), 0);
+			ccv_matrix_getter_a(a->type, ccv_matrix_setter_getter, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
 #undef x_block
-	}
+		}
+		ccfree(buf);
+	} parallel_endfor
 #undef for_block
 }
 
+/* the horizontal pass of ccv_sample_up for single channel 8U and 32F, with the weights of the plain loop, as many
+ * columns at a time as fit while the taps stay inside the row, returns the column the plain loop continues from */
+static inline int _ccv_sample_up_horizontal(int type, int ch, unsigned char* a_ptr, int sx, int a_cols, unsigned char* row, int x, int end)
+{
+#ifdef HAVE_SSE2
+	if (ch != 1)
+		return x;
+	if (CCV_GET_DATA_TYPE(type) == CCV_8U)
+	{
+		__m128i z = _mm_setzero_si128();
+		__m128i g025 = _mm_set1_epi16(23);
+		for (; x + 8 <= end && x + sx + 8 < a_cols; x += 8)
+		{
+			__m128i m1 = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(a_ptr + x + sx - 1)), z);
+			__m128i c = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(a_ptr + x + sx)), z), g025);
+			__m128i p1 = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(a_ptr + x + sx + 1)), z);
+			__m128i e = _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(m1, 3), c), p1);
+			__m128i o = _mm_add_epi16(_mm_add_epi16(m1, c), _mm_slli_epi16(p1, 3));
+			__m128i lo = _mm_unpacklo_epi16(e, o), hi = _mm_unpackhi_epi16(e, o);
+			int* r = (int*)row + x * 2;
+			_mm_storeu_si128((__m128i*)r, _mm_unpacklo_epi16(lo, z));
+			_mm_storeu_si128((__m128i*)(r + 4), _mm_unpackhi_epi16(lo, z));
+			_mm_storeu_si128((__m128i*)(r + 8), _mm_unpacklo_epi16(hi, z));
+			_mm_storeu_si128((__m128i*)(r + 12), _mm_unpackhi_epi16(hi, z));
+		}
+	} else if (CCV_GET_DATA_TYPE(type) == CCV_32F) {
+		/* the weights are doubles, so is the arithmetic */
+		__m128d g025 = _mm_set1_pd(0.705385);
+		__m128d g075 = _mm_set1_pd(0.259496);
+		__m128d g125 = _mm_set1_pd(0.035119);
+		for (; x + 2 <= end && x + sx + 2 < a_cols; x += 2)
+		{
+			float* p = (float*)a_ptr + x + sx;
+			__m128d m1 = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((__m128i*)(p - 1))));
+			__m128d c = _mm_mul_pd(_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((__m128i*)p))), g025);
+			__m128d p1 = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((__m128i*)(p + 1))));
+			__m128 e = _mm_cvtpd_ps(_mm_add_pd(_mm_add_pd(_mm_mul_pd(m1, g075), c), _mm_mul_pd(p1, g125)));
+			__m128 o = _mm_cvtpd_ps(_mm_add_pd(_mm_add_pd(_mm_mul_pd(m1, g125), c), _mm_mul_pd(p1, g075)));
+			_mm_storeu_ps((float*)row + x * 2, _mm_unpacklo_ps(e, o));
+		}
+	}
+#endif
+	return x;
+}
+
+/* the vertical pass of ccv_sample_up from 8U to 8U and from 32F to 32F, returns how many columns are done */
+static inline int _ccv_sample_up_vertical(int type, int btype, unsigned char** rows, unsigned char* b_ptr, int step, int count)
+{
+	int x = 0;
+#ifdef HAVE_SSE2
+	if (CCV_GET_DATA_TYPE(type) == CCV_8U && CCV_GET_DATA_TYPE(btype) == CCV_8U)
+	{
+		int i;
+		for (; x < count - 7; x += 8)
+		{
+			__m128i e[2], o[2];
+			for (i = 0; i < 2; i++)
+			{
+				__m128i r0 = _mm_loadu_si128((__m128i*)((int*)rows[0] + x + i * 4));
+				__m128i r1 = _mm_loadu_si128((__m128i*)((int*)rows[1] + x + i * 4));
+				__m128i r2 = _mm_loadu_si128((__m128i*)((int*)rows[2] + x + i * 4));
+				/* 23 = 16 + 4 + 2 + 1, and the sums are never negative, so the shift is the division */
+				r1 = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(r1, 4), _mm_slli_epi32(r1, 2)), _mm_add_epi32(_mm_slli_epi32(r1, 1), r1));
+				e[i] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(r0, 3), r1), r2), 10);
+				o[i] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(r0, r1), _mm_slli_epi32(r2, 3)), 10);
+			}
+			_mm_storel_epi64((__m128i*)(b_ptr + x), _mm_packus_epi16(_mm_packs_epi32(e[0], e[1]), e[0]));
+			_mm_storel_epi64((__m128i*)(b_ptr + step + x), _mm_packus_epi16(_mm_packs_epi32(o[0], o[1]), o[0]));
+		}
+	} else if (CCV_GET_DATA_TYPE(type) == CCV_32F && CCV_GET_DATA_TYPE(btype) == CCV_32F) {
+		__m128d g025 = _mm_set1_pd(0.705385);
+		__m128d g075 = _mm_set1_pd(0.259496);
+		__m128d g125 = _mm_set1_pd(0.035119);
+		for (; x < count - 1; x += 2)
+		{
+			__m128d r0 = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((__m128i*)((float*)rows[0] + x))));
+			__m128d r1 = _mm_mul_pd(_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((__m128i*)((float*)rows[1] + x)))), g025);
+			__m128d r2 = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((__m128i*)((float*)rows[2] + x))));
+			_mm_storel_epi64((__m128i*)((float*)b_ptr + x), _mm_castps_si128(_mm_cvtpd_ps(_mm_add_pd(_mm_add_pd(_mm_mul_pd(r0, g075), r1), _mm_mul_pd(r2, g125)))));
+			_mm_storel_epi64((__m128i*)((float*)(b_ptr + step) + x), _mm_castps_si128(_mm_cvtpd_ps(_mm_add_pd(_mm_add_pd(_mm_mul_pd(r0, g125), r1), _mm_mul_pd(r2, g075)))));
+		}
+	}
+#endif
+	return x;
+}
+
 void ccv_sample_up(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, int src_x, int src_y)
 {
 	assert(src_x >= 0 && src_y >= 0);
@@ -455,20 +779,15 @@ void ccv_sample_up(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, int
 	int ch = CCV_GET_CHANNEL(a->type);
 	int cols0 = a->cols - 1 - src_x;
 	assert(a->cols > 0 && cols0 > 0);
-	int y, x, sy = -1 + src_y, sx = src_x * ch, k;
+	int sx = src_x * ch, i, j;
 	int* tab = (int*)alloca((a->cols + src_x + 2) * ch * sizeof(int));
-	for (x = 0; x < a->cols + src_x + 2; x++)
-		for (k = 0; k < ch; k++)
-			tab[x * ch + k] = ((x >= a->cols) ? a->cols * 2 - 1 - x : x) * ch + k;
-	unsigned char* buf = (unsigned char*)alloca(3 * db->cols * ch * ccv_max(CCV_GET_DATA_TYPE_SIZE(db->type), sizeof(int)));
+	for (i = 0; i < a->cols + src_x + 2; i++)
+		for (j = 0; j < ch; j++)
+			tab[i * ch + j] = ((i >= a->cols) ? a->cols * 2 - 1 - i : i) * ch + j;
 	int bufstep = db->cols * ch * ccv_max(CCV_GET_DATA_TYPE_SIZE(db->type), sizeof(int));
-#ifdef __clang_analyzer__
-	memset(buf, 0, 3 * bufstep);
-#endif
-	unsigned char* b_ptr = db->data.u8;
 	/* why src_y * 2: the same argument as in ccv_sample_down */
 #define for_block(_for_get_a, _for_set, _for_get, _for_set_b) \
-	for (y = 0; y < a->rows; y++) \
+	for (y = y0; y < y1; y++) \
 	{ \
 		for (; sy <= y + 1 + src_y; sy++) \
 		{ \
@@ -498,7 +817,7 @@ void ccv_sample_up(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, int
 			 * XXYY
 			 * in this case, to upsampling, the weight should be from distance 0.25 and 1.25, and 0.25 and 0.75
 			 * previously, it was mistakingly be 0.0 1.0, 0.5 0.5 (imperfect upsampling (2x - 1)) */ \
-			for (x = (sx == 0) ? ch : 0; x < cols0 * ch; x += ch) \
+			for (x = _ccv_sample_up_horizontal(a->type, ch, a_ptr, sx, a->cols, row, (sx == 0) ? ch : 0, cols0 * ch); x < cols0 * ch; x += ch) \
 			{ \
 				for (k = 0; k < ch; k++) \
 				{ \
@@ -511,7 +830,7 @@ void ccv_sample_up(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, int
 		unsigned char* rows[3]; \
 		for (k = 0; k < 3; k++) \
 			rows[k] = buf + ((y + k) % 3) * bufstep; \
-		for (x = 0; x < db->cols * ch; x++) \
+		for (x = _ccv_sample_up_vertical(a->type, db->type, rows, b_ptr, db->step, db->cols * ch); x < db->cols * ch; x++) \
 		{ \
 			_for_set_b(b_ptr, x, (_for_get(rows[0], x, 0) * G075 + _for_get(rows[1], x, 0) * G025 + _for_get(rows[2], x, 0) * G125) / GALL, 0); \
 			_for_set_b(b_ptr + db->step, x, (_for_get(rows[0], x, 0) * G125 + _for_get(rows[1], x, 0) * G025 + _for_get(rows[2], x, 0) * G075) / GALL, 0); \
@@ -519,68 +838,278 @@ void ccv_sample_up(ccv_dense_matrix_t* a, ccv_dense_matrix_t** b, int type, int
 		b_ptr += 2 * db->step; \
 	}
 	int no_8u_type = (a->type & CCV_8U) ? CCV_32S : a->type;
-	/* unswitch if condition in manual way */
-	if ((a->type & CCV_8U) || (a->type & CCV_32S) || (a->type & CCV_64S))
-	{
+	/* a band of source rows fills its own 3-row buffer from the row above its first one on, and writes
+	 * two output rows for each of them */
+	int band_count = ccv_min(_ccv_resample_band_count(db), a->rows);
+	parallel_for(band, band_count) {
+		int x, y, k;
+		int y0 = band * a->rows / band_count;
+		int y1 = (band + 1) * a->rows / band_count;
+		int sy = y0 - 1 + src_y;
+		unsigned char* buf = (unsigned char*)ccmalloc(3 * bufstep);
+#ifdef __clang_analyzer__
+		memset(buf, 0, 3 * bufstep);
+#endif
+		unsigned char* b_ptr = db->data.u8 + db->step * 2 * y0;
+		/* unswitch if condition in manual way */
+		if ((a->type & CCV_8U) || (a->type & CCV_32S) || (a->type & CCV_64S))
+		{
 #define G025 (23)
 #define G075 (8)
 #define G125 (1)
 #define GALL (1024)
-		if (src_x > 0)
-		{
+			if (src_x > 0)
+			{
+#define x_block(_for_get_a, _for_set, _for_get, _for_set_b) \
+				for (x = cols0 * ch; x < a->cols * ch; x += ch) \
+					for (k = 0; k < ch; k++) \
+					{ \
+						_for_set(row, x * 2 + k, _for_get_a(a_ptr, tab[x + sx - ch + k], 0) * G075 + _for_get_a(a_ptr, tab[x + sx + k], 0) * G025 + _for_get_a(a_ptr, tab[x + sx + ch + k], 0) * G125, 0); \
+						_for_set(row, x * 2 + ch + k, _for_get_a(a_ptr, tab[x + sx - ch + k], 0) * G125 + _for_get_a(a_ptr, tab[x + sx + k], 0) * G025 + _for_get_a(a_ptr, tab[x + sx + ch + k], 0) * G075, 0); \
+				}
+				ccv_matrix_getter_integer_only(a->type, ccv_matrix_setter_getter_integer_only, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
+#undef x_block
+			} else {
 #define x_block(_for_get_a, _for_set, _for_get, _for_set_b) \
-			for (x = cols0 * ch; x < a->cols * ch; x += ch) \
 				for (k = 0; k < ch; k++) \
 				{ \
-					_for_set(row, x * 2 + k, _for_get_a(a_ptr, tab[x + sx - ch + k], 0) * G075 + _for_get_a(a_ptr, tab[x + sx + k], 0) * G025 + _for_get_a(a_ptr, tab[x + sx + ch + k], 0) * G125, 0); \
-					_for_set(row, x * 2 + ch + k, _for_get_a(a_ptr, tab[x + sx - ch + k], 0) * G125 + _for_get_a(a_ptr, tab[x + sx + k], 0) * G025 + _for_get_a(a_ptr, tab[x + sx + ch + k], 0) * G075, 0); \
-			}
-			ccv_matrix_getter_integer_only(a->type, ccv_matrix_setter_getter_integer_only, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
+					_for_set(row, (a->cols - 1) * 2 * ch + k, _for_get_a(a_ptr, (a->cols - 2) * ch + k, 0) * G075 + _for_get_a(a_ptr, (a->cols - 1) * ch + k, 0) * (G025 + G125), 0); \
+					_for_set(row, (a->cols - 1) * 2 * ch + ch + k, _for_get_a(a_ptr, (a->cols - 2) * ch + k, 0) * G125 + _for_get_a(a_ptr, (a->cols - 1) * ch + k, 0) * (G025 + G075), 0); \
+				}
+				ccv_matrix_getter_integer_only(a->type, ccv_matrix_setter_getter_integer_only, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
 #undef x_block
-		} else {
-#define x_block(_for_get_a, _for_set, _for_get, _for_set_b) \
-			for (k = 0; k < ch; k++) \
-			{ \
-				_for_set(row, (a->cols - 1) * 2 * ch + k, _for_get_a(a_ptr, (a->cols - 2) * ch + k, 0) * G075 + _for_get_a(a_ptr, (a->cols - 1) * ch + k, 0) * (G025 + G125), 0); \
-				_for_set(row, (a->cols - 1) * 2 * ch + ch + k, _for_get_a(a_ptr, (a->cols - 2) * ch + k, 0) * G125 + _for_get_a(a_ptr, (a->cols - 1) * ch + k, 0) * (G025 + G075), 0); \
 			}
-			ccv_matrix_getter_integer_only(a->type, ccv_matrix_setter_getter_integer_only, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
-#undef x_block
-		}
 #undef GALL
 #undef G125
 #undef G075
 #undef G025
-	} else {
+		} else {
 #define G025 (0.705385)
 #define G075 (0.259496)
 #define G125 (0.035119)
 #define GALL (1)
-		if (src_x > 0)
-		{
+			if (src_x > 0)
+			{
+#define x_block(_for_get_a, _for_set, _for_get, _for_set_b) \
+				for (x = cols0 * ch; x < a->cols * ch; x += ch) \
+					for (k = 0; k < ch; k++) \
+					{ \
+						_for_set(row, x * 2 + k, _for_get_a(a_ptr, tab[x + sx - ch + k], 0) * G075 + _for_get_a(a_ptr, tab[x + sx + k], 0) * G025 + _for_get_a(a_ptr, tab[x + sx + ch + k], 0) * G125, 0); \
+						_for_set(row, x * 2 + ch + k, _for_get_a(a_ptr, tab[x + sx - ch + k], 0) * G125 + _for_get_a(a_ptr, tab[x + sx + k], 0) * G025 + _for_get_a(a_ptr, tab[x + sx + ch + k], 0) * G075, 0); \
+				}
+				ccv_matrix_getter_float_only(a->type, ccv_matrix_setter_getter_float_only, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
+#undef x_block
+			} else {
 #define x_block(_for_get_a, _for_set, _for_get, _for_set_b) \
-			for (x = cols0 * ch; x < a->cols * ch; x += ch) \
 				for (k = 0; k < ch; k++) \
 				{ \
-					_for_set(row, x * 2 + k, _for_get_a(a_ptr, tab[x + sx - ch + k], 0) * G075 + _for_get_a(a_ptr, tab[x + sx + k], 0) * G025 + _for_get_a(a_ptr, tab[x + sx + ch + k], 0) * G125, 0); \
-					_for_set(row, x * 2 + ch + k, _for_get_a(a_ptr, tab[x + sx - ch + k], 0) * G125 + _for_get_a(a_ptr, tab[x + sx + k], 0) * G025 + _for_get_a(a_ptr, tab[x + sx + ch + k], 0) * G075, 0); \
-			}
-			ccv_matrix_getter_float_only(a->type, ccv_matrix_setter_getter_float_only, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
+					_for_set(row, (a->cols - 1) * 2 * ch + k, _for_get_a(a_ptr, (a->cols - 2) * ch + k, 0) * G075 + _for_get_a(a_ptr, (a->cols - 1) * ch + k, 0) * (G025 + G125), 0); \
+					_for_set(row, (a->cols - 1) * 2 * ch + ch + k, _for_get_a(a_ptr, (a->cols - 2) * ch + k, 0) * G125 + _for_get_a(a_ptr, (a->cols - 1) * ch + k, 0) * (G025 + G075), 0); \
+				}
+				ccv_matrix_getter_float_only(a->type, ccv_matrix_setter_getter_float_only, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
 #undef x_block
-		} else {
-#define x_block(_for_get_a, _for_set, _for_get, _for_set_b) \
-			for (k = 0; k < ch; k++) \
-			{ \
-				_for_set(row, (a->cols - 1) * 2 * ch + k, _for_get_a(a_ptr, (a->cols - 2) * ch + k, 0) * G075 + _for_get_a(a_ptr, (a->cols - 1) * ch + k, 0) * (G025 + G125), 0); \
-				_for_set(row, (a->cols - 1) * 2 * ch + ch + k, _for_get_a(a_ptr, (a->cols - 2) * ch + k, 0) * G125 + _for_get_a(a_ptr, (a->cols - 1) * ch + k, 0) * (G025 + G075), 0); \
 			}
-			ccv_matrix_getter_float_only(a->type, ccv_matrix_setter_getter_float_only, no_8u_type, ccv_matrix_setter_b, db->type, for_block);
-#undef x_block
-		}
 #undef GALL
 #undef G125
 #undef G075
 #undef G025
-	}
+		}
+		ccfree(buf);
+	} parallel_endfor
 #undef for_block
 }
+
+/* every image of a pyramid is the result of one operation on its input image (or on another image of the
+ * pyramid), and is looked up by exactly that */
+enum {
+	CCV_PYRAMID_RESAMPLE = 0x01,
+	CCV_PYRAMID_SAMPLE_DOWN = 0x02,
+	CCV_PYRAMID_SLICE = 0x04,
+};
+
+typedef struct {
+	ccv_dense_matrix_t* a;
+	int op;
+	int p0, p1, p2, p3;
+	ccv_dense_matrix_t* b;
+	ccv_pyramid_t* part; // the pyramid of a slice, its input image is b
+	int uses; // how many callers got b and haven't released it yet
+} ccv_pyramid_level_t;
+
+#ifdef USE_DISPATCH
+static dispatch_semaphore_t _ccv_pyramid_semaphore(void)
+{
+	static dispatch_semaphore_t sema;
+	static dispatch_once_t once;
+	dispatch_once(&once, ^{
+		sema = dispatch_semaphore_create(1);
+	});
+	return sema;
+}
+#endif
+
+/* the lookup and the insertion of a level are serialized, the levels themselves get computed in parallel */
+static ccv_dense_matrix_t* _ccv_pyramid_exchange(ccv_pyramid_t* pyramid, ccv_pyramid_level_t* level)
+{
+	int i;
+	ccv_dense_matrix_t* b = 0;
+#ifdef USE_DISPATCH
+	dispatch_semaphore_wait(_ccv_pyramid_semaphore(), DISPATCH_TIME_FOREVER);
+#endif
+#ifdef USE_OPENMP
+#pragma omp critical (ccv_pyramid)
+#endif
+	{
+		for (i = 0; i < pyramid->levels->rnum; i++)
+		{
+			ccv_pyramid_level_t* other = (ccv_pyramid_level_t*)ccv_array_get(pyramid->levels, i);
+			if (other->a == level->a && other->op == level->op && other->p0 == level->p0 && other->p1 == level->p1 && other->p2 == level->p2 && other->p3 == level->p3)
+			{
+				b = other->b;
+				level->part = other->part;
+				++other->uses;
+				break;
+			}
+		}
+		if (!b && level->b)
+		{
+			level->uses = 1;
+			ccv_array_push(pyramid->levels, level);
+		}
+	}
+#ifdef USE_DISPATCH
+	dispatch_semaphore_signal(_ccv_pyramid_semaphore());
+#endif
+	return b;
+}
+
+ccv_pyramid_t* ccv_pyramid_new(ccv_dense_matrix_t* a)
+{
+	ccv_pyramid_t* pyramid = (ccv_pyramid_t*)ccmalloc(sizeof(ccv_pyramid_t));
+	pyramid->a = a;
+	pyramid->retain = 1;
+	pyramid->levels = ccv_array_new(sizeof(ccv_pyramid_level_t), 32, 0);
+	return pyramid;
+}
+
+ccv_dense_matrix_t* ccv_pyramid_resample(ccv_pyramid_t* pyramid, ccv_dense_matrix_t* a, int rows, int cols, int type)
+{
+	ccv_pyramid_level_t level = {
+		.a = a,
+		.op = CCV_PYRAMID_RESAMPLE,
+		.p0 = rows,
+		.p1 = cols,
+		.p2 = type,
+	};
+	ccv_dense_matrix_t* b = _ccv_pyramid_exchange(pyramid, &level);
+	if (b)
+		return b;
+	ccv_resample(a, &level.b, 0, rows, cols, type);
+	/* another thread may have computed the same image in the meantime, keep the first one */
+	b = _ccv_pyramid_exchange(pyramid, &level);
+	if (!b)
+		return level.b;
+	ccv_matrix_free(level.b);
+	return b;
+}
+
+ccv_dense_matrix_t* ccv_pyramid_sample_down(ccv_pyramid_t* pyramid, ccv_dense_matrix_t* a, int src_x, int src_y)
+{
+	ccv_pyramid_level_t level = {
+		.a = a,
+		.op = CCV_PYRAMID_SAMPLE_DOWN,
+		.p0 = src_x,
+		.p1 = src_y,
+	};
+	ccv_dense_matrix_t* b = _ccv_pyramid_exchange(pyramid, &level);
+	if (b)
+		return b;
+	ccv_sample_down(a, &level.b, 0, src_x, src_y);
+	b = _ccv_pyramid_exchange(pyramid, &level);
+	if (!b)
+		return level.b;
+	ccv_matrix_free(level.b);
+	return b;
+}
+
+void ccv_pyramid_release(ccv_pyramid_t* pyramid, ccv_dense_matrix_t* b)
+{
+	int i;
+	ccv_dense_matrix_t* unused = 0;
+	ccv_pyramid_t* part = 0;
+#ifdef USE_DISPATCH
+	dispatch_semaphore_wait(_ccv_pyramid_semaphore(), DISPATCH_TIME_FOREVER);
+#endif
+#ifdef USE_OPENMP
+#pragma omp critical (ccv_pyramid)
+#endif
+	{
+		for (i = 0; i < pyramid->levels->rnum; i++)
+		{
+			ccv_pyramid_level_t* level = (ccv_pyramid_level_t*)ccv_array_get(pyramid->levels, i);
+			if (level->b == b)
+			{
+				if (--level->uses <= 0 && !pyramid->retain)
+				{
+					unused = b;
+					part = level->part;
+					*level = *(ccv_pyramid_level_t*)ccv_array_get(pyramid->levels, pyramid->levels->rnum - 1);
+					--pyramid->levels->rnum;
+				}
+				break;
+			}
+		}
+		/* the images computed from it can't be looked up any more, the memory of b may get reused by another image */
+		if (unused)
+			for (i = 0; i < pyramid->levels->rnum; i++)
+			{
+				ccv_pyramid_level_t* level = (ccv_pyramid_level_t*)ccv_array_get(pyramid->levels, i);
+				if (level->a == unused)
+					level->a = 0;
+			}
+	}
+#ifdef USE_DISPATCH
+	dispatch_semaphore_signal(_ccv_pyramid_semaphore());
+#endif
+	if (part)
+		ccv_pyramid_free(part);
+	if (unused)
+		ccv_matrix_free(unused);
+}
+
+ccv_pyramid_t* ccv_pyramid_slice(ccv_pyramid_t* pyramid, int x, int y, int rows, int cols)
+{
+	ccv_pyramid_level_t level = {
+		.a = pyramid->a,
+		.op = CCV_PYRAMID_SLICE,
+		.p0 = y,
+		.p1 = x,
+		.p2 = rows,
+		.p3 = cols,
+	};
+	if (_ccv_pyramid_exchange(pyramid, &level))
+		return level.part;
+	ccv_slice(pyramid->a, (ccv_matrix_t**)&level.b, 0, y, x, rows, cols);
+	level.part = ccv_pyramid_new(level.b);
+	level.part->retain = pyramid->retain;
+	ccv_pyramid_t* part = level.part;
+	if (!_ccv_pyramid_exchange(pyramid, &level))
+		return part;
+	ccv_pyramid_free(part);
+	ccv_matrix_free(level.b);
+	return level.part;
+}
+
+void ccv_pyramid_free(ccv_pyramid_t* pyramid)
+{
+	int i;
+	for (i = 0; i < pyramid->levels->rnum; i++)
+	{
+		ccv_pyramid_level_t* level = (ccv_pyramid_level_t*)ccv_array_get(pyramid->levels, i);
+		if (level->part)
+			ccv_pyramid_free(level->part);
+		ccv_matrix_free(level->b);
+	}
+	ccv_array_free(pyramid->levels);
+	ccfree(pyramid);
+}
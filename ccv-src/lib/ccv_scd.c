@@ -1650,28 +1650,85 @@ static int _ccv_is_equal_same_class(const void* _r1, const void* _r2, void* data
 	return i >= 0.3 * m; // IoM > 0.3 like HeadHunter does
 }
 
-ccv_array_t* ccv_scd_detect_objects(ccv_dense_matrix_t* a, ccv_scd_classifier_cascade_t** cascades, int count, ccv_scd_param_t params)
+/* overlapping rectangles only, except that an empty one has no area to overlap with and matches anything of its class */
+static int _ccv_is_equal_bound(const void* _r, ccv_rect_t* bound, void* data)
+{
+	const ccv_comp_t* r = (const ccv_comp_t*)_r;
+	*bound = r->rect;
+	return r->rect.width > 0 && r->rect.height > 0;
+}
+
+/* whether objects of this size are neither smaller than min_size nor larger than max_size */
+static inline int _ccv_scd_is_size_in_range(double width, double height, ccv_scd_param_t params)
+{
+	return width >= params.min_size.width && height >= params.min_size.height &&
+		(params.max_size.width <= 0 || params.max_size.height <= 0 || (width <= params.max_size.width && height <= params.max_size.height));
+}
+
+/* level i finds objects between 2^i and 2^(i+1) times the size of a cascade */
+static int _ccv_scd_is_level_in_range(ccv_scd_classifier_cascade_t** cascades, int count, float up_ratio, int i, ccv_scd_param_t params)
+{
+	int j;
+	for (j = 0; j < count; j++)
+	{
+		double width = (cascades[j]->size.width - cascades[j]->margin.left - cascades[j]->margin.right) * (double)(1 << i) / up_ratio;
+		double height = (cascades[j]->size.height - cascades[j]->margin.top - cascades[j]->margin.bottom) * (double)(1 << i) / up_ratio;
+		if (width * 2 >= params.min_size.width && height * 2 >= params.min_size.height &&
+			(params.max_size.width <= 0 || params.max_size.height <= 0 || (width <= params.max_size.width && height <= params.max_size.height)))
+			return 1;
+	}
+	return 0;
+}
+
+ccv_array_t* ccv_scd_detect_objects_in_pyramid(ccv_pyramid_t* pyramid, ccv_scd_classifier_cascade_t** cascades, int count, ccv_scd_param_t params)
 {
 	int i, j, k, x, y, p, q;
+	ccv_dense_matrix_t* a = pyramid->a;
+	if (params.roi.width > 0 && params.roi.height > 0)
+	{
+		/* only search inside the region of interest, with its own pyramid that the pyramid keeps for anyone else
+		 * searching the same region, and move what gets found there back into the image */
+		x = ccv_max(params.roi.x, 0);
+		y = ccv_max(params.roi.y, 0);
+		int cols = ccv_min(params.roi.x + params.roi.width, a->cols) - x;
+		int rows = ccv_min(params.roi.y + params.roi.height, a->rows) - y;
+		params.roi = ccv_rect(0, 0, 0, 0);
+		if (rows <= 0 || cols <= 0)
+			return ccv_array_new(sizeof(ccv_comp_t), 64, 0);
+		if (x > 0 || y > 0 || rows < a->rows || cols < a->cols)
+		{
+			ccv_pyramid_t* part = ccv_pyramid_slice(pyramid, x, y, rows, cols);
+			ccv_array_t* seq = ccv_scd_detect_objects_in_pyramid(part, cascades, count, params);
+			ccv_pyramid_release(pyramid, part->a);
+			for (i = 0; i < seq->rnum; i++)
+			{
+				ccv_comp_t* comp = (ccv_comp_t*)ccv_array_get(seq, i);
+				comp->rect.x += x;
+				comp->rect.y += y;
+			}
+			return seq;
+		}
+	}
 	int scale_upto = 1;
 	float up_ratio = 1.0;
+	/* no need to scale the image up for objects smaller than min_size */
+	ccv_size_t size = ccv_size(ccv_max(params.size.width, params.min_size.width), ccv_max(params.size.height, params.min_size.height));
 	for (i = 0; i < count; i++)
-		up_ratio = ccv_max(up_ratio, ccv_max((float)cascades[i]->size.width / params.size.width, (float)cascades[i]->size.height / params.size.height));
+		up_ratio = ccv_max(up_ratio, ccv_max((float)cascades[i]->size.width / size.width, (float)cascades[i]->size.height / size.height));
 	if (up_ratio - 1.0 > 1e-4)
-	{
-		ccv_dense_matrix_t* resized = 0;
-		ccv_resample(a, &resized, 0, (int)(a->rows * up_ratio + 0.5), (int)(a->cols * up_ratio + 0.5), CCV_INTER_CUBIC);
-		a = resized;
-	}
+		a = ccv_pyramid_resample(pyramid, a, (int)(a->rows * up_ratio + 0.5), (int)(a->cols * up_ratio + 0.5), CCV_INTER_CUBIC);
 	for (i = 0; i < count; i++)
 		scale_upto = ccv_max(scale_upto, (int)(log(ccv_min((double)a->rows / (cascades[i]->size.height - cascades[i]->margin.top - cascades[i]->margin.bottom), (double)a->cols / (cascades[i]->size.width - cascades[i]->margin.left - cascades[i]->margin.right))) / log(2.) - DBL_MIN) + 1);
-	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca(sizeof(ccv_dense_matrix_t*) * scale_upto);
+	/* the levels that only find objects outside of min_size and max_size are never built */
+	int scale_from = 0;
+	while (scale_from < scale_upto && !_ccv_scd_is_level_in_range(cascades, count, up_ratio, scale_from, params))
+		++scale_from;
+	while (scale_upto > scale_from && !_ccv_scd_is_level_in_range(cascades, count, up_ratio, scale_upto - 1, params))
+		--scale_upto;
+	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca(sizeof(ccv_dense_matrix_t*) * ccv_max(scale_upto, 1));
 	pyr[0] = a;
-	for (i = 1; i < scale_upto; i++)
-	{
-		pyr[i] = 0;
-		ccv_sample_down(pyr[i - 1], &pyr[i], 0, 0, 0);
-	}
+	for (i = ccv_max(scale_from, 1); i < scale_upto; i++)
+		pyr[i] = i == scale_from ? ccv_pyramid_resample(pyramid, a, a->rows >> i, a->cols >> i, CCV_INTER_AREA) : ccv_pyramid_sample_down(pyramid, pyr[i - 1], 0, 0);
 #if defined(HAVE_SSE2)
 	__m128 surf[8];
 #else
@@ -1680,7 +1737,7 @@ ccv_array_t* ccv_scd_detect_objects(ccv_dense_matrix_t* a, ccv_scd_classifier_ca
 	ccv_array_t** seq = (ccv_array_t**)alloca(sizeof(ccv_array_t*) * count);
 	for (i = 0; i < count; i++)
 		seq[i] = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
-	for (i = 0; i < scale_upto; i++)
+	for (i = scale_from; i < scale_upto; i++)
 	{
 		// run it
 		for (j = 0; j < count; j++)
@@ -1688,29 +1745,26 @@ ccv_array_t* ccv_scd_detect_objects(ccv_dense_matrix_t* a, ccv_scd_classifier_ca
 			double scale_ratio = pow(2., 1. / (params.interval + 1));
 			double scale = 1;
 			ccv_scd_classifier_cascade_t* cascade = cascades[j];
-			for (k = 0; k <= params.interval; k++)
+			for (k = 0; k <= params.interval; k++, scale *= scale_ratio)
 			{
 				int rows = (int)(pyr[i]->rows / scale + 0.5);
 				int cols = (int)(pyr[i]->cols / scale + 0.5);
 				if (rows < cascade->size.height || cols < cascade->size.width)
 					break;
-				ccv_dense_matrix_t* image = k == 0 ? pyr[i] : 0;
-				if (k > 0)
-					ccv_resample(pyr[i], &image, 0, rows, cols, CCV_INTER_AREA);
+				if (!_ccv_scd_is_size_in_range((cascade->size.width - cascade->margin.left - cascade->margin.right) * (scale / up_ratio) * (1 << i), (cascade->size.height - cascade->margin.top - cascade->margin.bottom) * (scale / up_ratio) * (1 << i), params))
+					continue;
+				ccv_dense_matrix_t* image = k == 0 ? pyr[i] : ccv_pyramid_resample(pyramid, pyr[i], rows, cols, CCV_INTER_AREA);
 				ccv_dense_matrix_t* scd = 0;
 				if (cascade->margin.left == 0 && cascade->margin.top == 0 && cascade->margin.right == 0 && cascade->margin.bottom == 0)
-				{
 					ccv_scd(image, &scd, 0);
-					if (k > 0)
-						ccv_matrix_free(image);
-				} else {
+				else {
 					ccv_dense_matrix_t* bordered = 0;
 					ccv_border(image, (ccv_matrix_t**)&bordered, 0, cascade->margin);
-					if (k > 0)
-						ccv_matrix_free(image);
 					ccv_scd(bordered, &scd, 0);
 					ccv_matrix_free(bordered);
 				}
+				if (k > 0)
+					ccv_pyramid_release(pyramid, image);
 				ccv_dense_matrix_t* sat = 0;
 				ccv_sat(scd, &sat, 0, CCV_PADDING_ZERO);
 				assert(CCV_GET_CHANNEL(sat->type) == CCV_SCD_CHANNEL);
@@ -1780,15 +1834,12 @@ ccv_array_t* ccv_scd_detect_objects(ccv_dense_matrix_t* a, ccv_scd_classifier_ca
 					ptr += sat->cols * CCV_SCD_CHANNEL * params.step_through;
 				}
 				ccv_matrix_free(sat);
-				scale *= scale_ratio;
 			}
 		}
+		if (i > 0)
+			ccv_pyramid_release(pyramid, pyr[i]);
 	}
-
-	for (i = 1; i < scale_upto; i++)
-		ccv_matrix_free(pyr[i]);
-	if (up_ratio - 1.0 > 1e-4)
-		ccv_matrix_free(a);
+	ccv_pyramid_release(pyramid, a);
 
 	ccv_array_t* result_seq = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
 	for (k = 0; k < count; k++)
@@ -1804,7 +1855,7 @@ ccv_array_t* ccv_scd_detect_objects(ccv_dense_matrix_t* a, ccv_scd_classifier_ca
 		} else {
 			ccv_array_t* idx_seq = 0;
 			// group retrieved rectangles in order to filter out noise
-			int ncomp = ccv_array_group(seq[k], &idx_seq, _ccv_is_equal_same_class, 0);
+			int ncomp = ccv_array_group_bounded(seq[k], &idx_seq, _ccv_is_equal_same_class, _ccv_is_equal_bound, 0);
 			ccv_comp_t* comps = (ccv_comp_t*)cccalloc(ncomp + 1, sizeof(ccv_comp_t));
 
 			// count number of neighbors
@@ -1838,3 +1889,41 @@ ccv_array_t* ccv_scd_detect_objects(ccv_dense_matrix_t* a, ccv_scd_classifier_ca
 
 	return result_seq;
 }
+
+ccv_array_t* ccv_scd_detect_objects(ccv_dense_matrix_t* a, ccv_scd_classifier_cascade_t** cascades, int count, ccv_scd_param_t params)
+{
+	ccv_pyramid_t* pyramid = ccv_pyramid_new(a);
+	pyramid->retain = 0;
+	ccv_array_t* seq = ccv_scd_detect_objects_in_pyramid(pyramid, cascades, count, params);
+	ccv_pyramid_free(pyramid);
+	return seq;
+}
+
+ccv_array_t* ccv_scd_detect_objects_in_video(ccv_detect_video_t* video, ccv_dense_matrix_t* a, ccv_scd_classifier_cascade_t** cascades, int count, ccv_scd_param_t params)
+{
+	ccv_rect_t roi = (params.roi.width > 0 && params.roi.height > 0) ? params.roi : ccv_rect(0, 0, a->cols, a->rows);
+	ccv_array_t* regions = ccv_detect_video_regions(video, roi, params.min_size, params.max_size);
+	if (!regions)
+	{
+		ccv_array_t* seq = ccv_scd_detect_objects(a, cascades, count, params);
+		ccv_detect_video_update(video, seq);
+		return seq;
+	}
+	int i, j;
+	ccv_array_t* seq = ccv_array_new(sizeof(ccv_comp_t), 64, 0);
+	for (i = 0; i < regions->rnum; i++)
+	{
+		ccv_detect_video_region_t* region = (ccv_detect_video_region_t*)ccv_array_get(regions, i);
+		ccv_scd_param_t region_params = params;
+		region_params.roi = region->roi;
+		region_params.min_size = region->min_size;
+		region_params.max_size = region->max_size;
+		ccv_array_t* region_seq = ccv_scd_detect_objects(a, cascades, count, region_params);
+		for (j = 0; j < region_seq->rnum; j++)
+			ccv_array_push(seq, ccv_array_get(region_seq, j));
+		ccv_array_free(region_seq);
+	}
+	ccv_array_free(regions);
+	ccv_detect_video_update(video, seq);
+	return seq;
+}
@@ -31,6 +31,19 @@
 
 #include "ccv.h"
 #include "ccv_internal.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+#if defined(HAVE_SSE2)
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <immintrin.h>
+#define HAVE_SIFT_AVX2
+#endif
+#endif
 
 const ccv_sift_param_t ccv_sift_default_params = {
 	.noctaves = 3,
@@ -414,11 +427,17 @@ void ccv_sift(ccv_dense_matrix_t* a, ccv_array_t** _keypoints, ccv_dense_matrix_
 	/* calculate descriptor */
 	if (_desc != 0)
 	{
-		ccv_dense_matrix_t* desc = *_desc = ccv_dense_matrix_new(keypoints->rnum, 128, CCV_32F | CCV_C1, 0, 0);
-		float* fdesc = desc->data.f32;
-		memset(fdesc, 0, sizeof(float) * keypoints->rnum * 128);
+		/* CCV_8U descriptors are quantized like VLFeat does, 512 times the float value saturated to 255 */
+		int quantize = (CCV_GET_DATA_TYPE(type) == CCV_8U);
+		ccv_dense_matrix_t* desc = *_desc = ccv_dense_matrix_new(keypoints->rnum, 128, (quantize ? CCV_8U : CCV_32F) | CCV_C1, 0, 0);
+		float qdesc[128];
+		float* fdesc = quantize ? qdesc : desc->data.f32;
+		if (!quantize)
+			memset(fdesc, 0, sizeof(float) * keypoints->rnum * 128);
 		for (i = 0; i < keypoints->rnum; i++)
 		{
+			if (quantize)
+				memset(fdesc, 0, sizeof(float) * 128);
 			ccv_keypoint_t* kp = (ccv_keypoint_t*)ccv_array_get(keypoints, i);
 			float ds = pow(2.0, kp->octave);
 			float dx = kp->x / ds;
@@ -476,7 +495,13 @@ void ccv_sift(ccv_dense_matrix_t* a, ccv_array_t** _keypoints, ccv_dense_matrix_
 						fdesc[j] = 0.2;
 				ccv_normalize(&tm, (ccv_matrix_t**)&tmp, 0, CCV_L2_NORM);
 			}
-			fdesc += 128;
+			if (quantize)
+			{
+				unsigned char* u8desc = desc->data.u8 + i * desc->step;
+				for (j = 0; j < 128; j++)
+					u8desc[j] = (unsigned char)ccv_min((int)(fdesc[j] * 512 + 0.5), 255);
+			} else
+				fdesc += 128;
 		}
 	}
 	for (i = (params.up2x ? -(params.nlevels - 1) : 0); i < (params.nlevels - 1) * params.noctaves; i++)
@@ -487,3 +512,675 @@ void ccv_sift(ccv_dense_matrix_t* a, ccv_array_t** _keypoints, ccv_dense_matrix_
 		ccv_matrix_free(md[i]);
 	}
 }
+
+const ccv_sift_match_param_t ccv_sift_match_default_params = {
+	.checks = 256,
+	.ratio = 0.6,
+	.norm = CCV_L2_NORM,
+};
+
+/* the randomized kd-forest follows Silpa-Anan & Hartley's "Optimised KD-trees for fast image descriptor matching"
+ * and Muja & Lowe's FLANN: every tree splits on one of the few highest variance dimensions picked at random, and
+ * all trees share one priority queue during the search */
+
+#define CCV_SIFT_KD_LEAF_SIZE (4)
+#define CCV_SIFT_KD_SAMPLE_SIZE (100)
+#define CCV_SIFT_KD_RAND_DIM (5)
+
+static inline unsigned int _ccv_sift_kd_rand(unsigned int* seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return (*seed >> 16) & 0x7fff;
+}
+
+static inline float _ccv_sift_desc_value(ccv_dense_matrix_t* desc, int row, int dim)
+{
+	const unsigned char* p = desc->data.u8 + (size_t)row * desc->step;
+	return CCV_GET_DATA_TYPE(desc->type) == CCV_8U ? p[dim] : ((const float*)p)[dim];
+}
+
+static int _ccv_sift_kd_build(ccv_array_t* nodes, ccv_dense_matrix_t* desc, int* idx, int begin, int end, unsigned int* seed)
+{
+	int i, j;
+	int nid = nodes->rnum;
+	ccv_sift_kd_node_t node = {
+		.dim = -1,
+		.left = begin,
+		.right = end,
+	};
+	ccv_array_push(nodes, &node);
+	if (end - begin <= CCV_SIFT_KD_LEAF_SIZE)
+		return nid;
+	double mean[128], var[128];
+	memset(mean, 0, sizeof(mean));
+	memset(var, 0, sizeof(var));
+	int count = ccv_min(end - begin, CCV_SIFT_KD_SAMPLE_SIZE);
+	for (i = 0; i < count; i++)
+		for (j = 0; j < 128; j++)
+			mean[j] += _ccv_sift_desc_value(desc, idx[begin + i], j);
+	for (j = 0; j < 128; j++)
+		mean[j] /= count;
+	for (i = 0; i < count; i++)
+		for (j = 0; j < 128; j++)
+		{
+			double d = _ccv_sift_desc_value(desc, idx[begin + i], j) - mean[j];
+			var[j] += d * d;
+		}
+	/* keep the top variance dimensions sorted, and pick one of them at random */
+	int top[CCV_SIFT_KD_RAND_DIM];
+	int ntop = 0;
+	for (j = 0; j < 128; j++)
+		if (ntop < CCV_SIFT_KD_RAND_DIM || var[j] > var[top[ntop - 1]])
+		{
+			int k = ntop < CCV_SIFT_KD_RAND_DIM ? ntop++ : ntop - 1;
+			for (; k > 0 && var[top[k - 1]] < var[j]; k--)
+				top[k] = top[k - 1];
+			top[k] = j;
+		}
+	int dim = top[_ccv_sift_kd_rand(seed) % ntop];
+	float value = (float)mean[dim];
+	/* partition in place, fall back to splitting in the middle if all points land on one side */
+	int lim = begin, k = end - 1;
+	while (lim <= k)
+	{
+		if (_ccv_sift_desc_value(desc, idx[lim], dim) < value)
+			++lim;
+		else {
+			int t;
+			CCV_SWAP(idx[lim], idx[k], t);
+			--k;
+		}
+	}
+	if (lim == begin || lim == end)
+		lim = (begin + end) / 2;
+	int left = _ccv_sift_kd_build(nodes, desc, idx, begin, lim, seed);
+	int right = _ccv_sift_kd_build(nodes, desc, idx, lim, end, seed);
+	ccv_sift_kd_node_t* p = (ccv_sift_kd_node_t*)ccv_array_get(nodes, nid);
+	p->dim = dim;
+	p->value = value;
+	p->left = left;
+	p->right = right;
+	return nid;
+}
+
+ccv_sift_index_t* ccv_sift_index_new(ccv_dense_matrix_t* desc, int trees)
+{
+	assert((CCV_GET_DATA_TYPE(desc->type) == CCV_32F || CCV_GET_DATA_TYPE(desc->type) == CCV_8U) && desc->cols == 128);
+	assert(trees > 0);
+	ccv_sift_index_t* index = (ccv_sift_index_t*)ccmalloc(sizeof(ccv_sift_index_t) + sizeof(int) * trees + sizeof(int) * trees * desc->rows);
+	index->trees = trees;
+	index->rnum = desc->rows;
+	index->root = (int*)(index + 1);
+	index->idx = index->root + trees;
+	index->nodes = ccv_array_new(sizeof(ccv_sift_kd_node_t), ccv_max(2, desc->rows / CCV_SIFT_KD_LEAF_SIZE * 2 * trees), 0);
+	unsigned int seed = 0x5eed;
+	int i, j;
+	for (i = 0; i < trees; i++)
+	{
+		int* idx = index->idx + i * index->rnum;
+		for (j = 0; j < index->rnum; j++)
+			idx[j] = j;
+		index->root[i] = _ccv_sift_kd_build(index->nodes, desc, idx, 0, index->rnum, &seed);
+	}
+	return index;
+}
+
+void ccv_sift_index_free(ccv_sift_index_t* index)
+{
+	ccv_array_free(index->nodes);
+	ccfree(index);
+}
+
+typedef struct {
+	float dist;
+	int node;
+	int tree;
+} ccv_sift_kd_branch_t;
+
+typedef struct {
+	const float* query;
+	const unsigned char* row;
+	const unsigned char* desc;
+	int step;
+	float (*dist)(const void* a, const void* b, float bound);
+	int l1;
+	int* visited;
+	int stamp;
+	int checks;
+	int checked;
+	float mind, mind2;
+	int minj;
+	ccv_sift_kd_branch_t* heap;
+	int heap_size;
+	int heap_rnum;
+} ccv_sift_kd_search_t;
+
+static inline void _ccv_sift_kd_heap_push(ccv_sift_kd_search_t* s, ccv_sift_kd_branch_t branch)
+{
+	if (s->heap_rnum >= s->heap_size)
+	{
+		s->heap_size = s->heap_size * 2;
+		s->heap = (ccv_sift_kd_branch_t*)ccrealloc(s->heap, sizeof(ccv_sift_kd_branch_t) * s->heap_size);
+	}
+	int i = s->heap_rnum++;
+	while (i > 0 && s->heap[(i - 1) >> 1].dist > branch.dist)
+	{
+		s->heap[i] = s->heap[(i - 1) >> 1];
+		i = (i - 1) >> 1;
+	}
+	s->heap[i] = branch;
+}
+
+static inline ccv_sift_kd_branch_t _ccv_sift_kd_heap_pop(ccv_sift_kd_search_t* s)
+{
+	ccv_sift_kd_branch_t top = s->heap[0];
+	ccv_sift_kd_branch_t last = s->heap[--s->heap_rnum];
+	int i = 0;
+	for (;;)
+	{
+		int c = i * 2 + 1;
+		if (c >= s->heap_rnum)
+			break;
+		if (c + 1 < s->heap_rnum && s->heap[c + 1].dist < s->heap[c].dist)
+			++c;
+		if (s->heap[c].dist >= last.dist)
+			break;
+		s->heap[i] = s->heap[c];
+		i = c;
+	}
+	s->heap[i] = last;
+	return top;
+}
+
+/* distance between two 128-d descriptors, the squared L2 distance or, for CCV_8U descriptors, the sum
+ * of absolute differences. The sum only grows, so every kernel may stop early once it exceeds bound,
+ * the returned value is then somewhere above bound. Integer sums are exact in a float */
+typedef float (*ccv_sift_dist_f)(const void* a, const void* b, float bound);
+
+#ifndef HAVE_SSE2
+static float _ccv_sift_l2_scalar(const void* x, const void* y, float bound)
+{
+	const float* a = (const float*)x;
+	const float* b = (const float*)y;
+	int k;
+	float d = 0;
+	for (k = 0; k < 128; k++)
+	{
+		d += (a[k] - b[k]) * (a[k] - b[k]);
+		if (d > bound)
+			break;
+	}
+	return d;
+}
+
+static float _ccv_sift_l2_8u_scalar(const void* x, const void* y, float bound)
+{
+	const unsigned char* a = (const unsigned char*)x;
+	const unsigned char* b = (const unsigned char*)y;
+	int i, k;
+	int d = 0;
+	for (k = 0; k < 128; k += 32)
+	{
+		for (i = k; i < k + 32; i++)
+			d += (a[i] - b[i]) * (a[i] - b[i]);
+		if (d > bound)
+			break;
+	}
+	return d;
+}
+
+static float _ccv_sift_l1_8u_scalar(const void* x, const void* y, float bound)
+{
+	const unsigned char* a = (const unsigned char*)x;
+	const unsigned char* b = (const unsigned char*)y;
+	int i, k;
+	int d = 0;
+	for (k = 0; k < 128; k += 32)
+	{
+		for (i = k; i < k + 32; i++)
+			d += abs(a[i] - b[i]);
+		if (d > bound)
+			break;
+	}
+	return d;
+}
+#else
+static inline float _ccv_sift_hsum_sse2(__m128 x)
+{
+	__m128 s = _mm_add_ps(x, _mm_movehl_ps(x, x));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+
+static inline int _ccv_sift_hsum_epi32_sse2(__m128i x)
+{
+	x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+	x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(x);
+}
+
+static float _ccv_sift_l2_sse2(const void* x, const void* y, float bound)
+{
+	const float* a = (const float*)x;
+	const float* b = (const float*)y;
+	int k;
+	float d = 0;
+	/* check the bound every 32 dimensions, a horizontal sum per 4 floats costs more than it saves */
+	for (k = 0; k < 128; k += 32)
+	{
+		__m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k));
+		__m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + k + 4), _mm_loadu_ps(b + k + 4));
+		__m128 d2 = _mm_sub_ps(_mm_loadu_ps(a + k + 8), _mm_loadu_ps(b + k + 8));
+		__m128 d3 = _mm_sub_ps(_mm_loadu_ps(a + k + 12), _mm_loadu_ps(b + k + 12));
+		__m128 s0 = _mm_mul_ps(d0, d0);
+		__m128 s1 = _mm_mul_ps(d1, d1);
+		__m128 s2 = _mm_mul_ps(d2, d2);
+		__m128 s3 = _mm_mul_ps(d3, d3);
+		d0 = _mm_sub_ps(_mm_loadu_ps(a + k + 16), _mm_loadu_ps(b + k + 16));
+		d1 = _mm_sub_ps(_mm_loadu_ps(a + k + 20), _mm_loadu_ps(b + k + 20));
+		d2 = _mm_sub_ps(_mm_loadu_ps(a + k + 24), _mm_loadu_ps(b + k + 24));
+		d3 = _mm_sub_ps(_mm_loadu_ps(a + k + 28), _mm_loadu_ps(b + k + 28));
+		s0 = _mm_add_ps(s0, _mm_mul_ps(d0, d0));
+		s1 = _mm_add_ps(s1, _mm_mul_ps(d1, d1));
+		s2 = _mm_add_ps(s2, _mm_mul_ps(d2, d2));
+		s3 = _mm_add_ps(s3, _mm_mul_ps(d3, d3));
+		d += _ccv_sift_hsum_sse2(_mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)));
+		if (d > bound)
+			break;
+	}
+	return d;
+}
+
+static float _ccv_sift_l2_8u_sse2(const void* x, const void* y, float bound)
+{
+	const unsigned char* a = (const unsigned char*)x;
+	const unsigned char* b = (const unsigned char*)y;
+	const __m128i z = _mm_setzero_si128();
+	int k;
+	int d = 0;
+	for (k = 0; k < 128; k += 32)
+	{
+		__m128i a0 = _mm_loadu_si128((const __m128i*)(a + k));
+		__m128i b0 = _mm_loadu_si128((const __m128i*)(b + k));
+		__m128i a1 = _mm_loadu_si128((const __m128i*)(a + k + 16));
+		__m128i b1 = _mm_loadu_si128((const __m128i*)(b + k + 16));
+		/* widen to 16 bits, the squares of neighboring differences add up to 32 bits in one madd */
+		__m128i d0 = _mm_sub_epi16(_mm_unpacklo_epi8(a0, z), _mm_unpacklo_epi8(b0, z));
+		__m128i d1 = _mm_sub_epi16(_mm_unpackhi_epi8(a0, z), _mm_unpackhi_epi8(b0, z));
+		__m128i d2 = _mm_sub_epi16(_mm_unpacklo_epi8(a1, z), _mm_unpacklo_epi8(b1, z));
+		__m128i d3 = _mm_sub_epi16(_mm_unpackhi_epi8(a1, z), _mm_unpackhi_epi8(b1, z));
+		__m128i s = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(d0, d0), _mm_madd_epi16(d1, d1)), _mm_add_epi32(_mm_madd_epi16(d2, d2), _mm_madd_epi16(d3, d3)));
+		d += _ccv_sift_hsum_epi32_sse2(s);
+		if (d > bound)
+			break;
+	}
+	return d;
+}
+
+static float _ccv_sift_l1_8u_sse2(const void* x, const void* y, float bound)
+{
+	const unsigned char* a = (const unsigned char*)x;
+	const unsigned char* b = (const unsigned char*)y;
+	int k;
+	int d = 0;
+	for (k = 0; k < 128; k += 32)
+	{
+		__m128i s = _mm_add_epi64(_mm_sad_epu8(_mm_loadu_si128((const __m128i*)(a + k)), _mm_loadu_si128((const __m128i*)(b + k))),
+			_mm_sad_epu8(_mm_loadu_si128((const __m128i*)(a + k + 16)), _mm_loadu_si128((const __m128i*)(b + k + 16))));
+		d += _mm_cvtsi128_si32(s) + _mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+		if (d > bound)
+			break;
+	}
+	return d;
+}
+#endif
+
+#ifdef HAVE_SIFT_AVX2
+__attribute__((target("avx2"))) static inline int _ccv_sift_hsum_epi32_avx2(__m256i x)
+{
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("avx2"))) static float _ccv_sift_l2_avx2(const void* x, const void* y, float bound)
+{
+	const float* a = (const float*)x;
+	const float* b = (const float*)y;
+	int k;
+	float d = 0;
+	for (k = 0; k < 128; k += 32)
+	{
+		__m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k));
+		__m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + k + 8), _mm256_loadu_ps(b + k + 8));
+		__m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(a + k + 16), _mm256_loadu_ps(b + k + 16));
+		__m256 d3 = _mm256_sub_ps(_mm256_loadu_ps(a + k + 24), _mm256_loadu_ps(b + k + 24));
+		__m256 s = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(d0, d0), _mm256_mul_ps(d1, d1)), _mm256_add_ps(_mm256_mul_ps(d2, d2), _mm256_mul_ps(d3, d3)));
+		__m128 h = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+		h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+		h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));
+		d += _mm_cvtss_f32(h);
+		if (d > bound)
+			break;
+	}
+	return d;
+}
+
+__attribute__((target("avx2"))) static float _ccv_sift_l2_8u_avx2(const void* x, const void* y, float bound)
+{
+	const unsigned char* a = (const unsigned char*)x;
+	const unsigned char* b = (const unsigned char*)y;
+	int k;
+	int d = 0;
+	for (k = 0; k < 128; k += 32)
+	{
+		__m256i d0 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + k))), _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + k))));
+		__m256i d1 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + k + 16))), _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + k + 16))));
+		d += _ccv_sift_hsum_epi32_avx2(_mm256_add_epi32(_mm256_madd_epi16(d0, d0), _mm256_madd_epi16(d1, d1)));
+		if (d > bound)
+			break;
+	}
+	return d;
+}
+
+__attribute__((target("avx2"))) static float _ccv_sift_l1_8u_avx2(const void* x, const void* y, float bound)
+{
+	const unsigned char* a = (const unsigned char*)x;
+	const unsigned char* b = (const unsigned char*)y;
+	int k;
+	int d = 0;
+	for (k = 0; k < 128; k += 32)
+	{
+		__m256i s = _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(a + k)), _mm256_loadu_si256((const __m256i*)(b + k)));
+		__m128i h = _mm_add_epi64(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+		d += _mm_cvtsi128_si32(h) + _mm_cvtsi128_si32(_mm_srli_si128(h, 8));
+		if (d > bound)
+			break;
+	}
+	return d;
+}
+#endif
+
+#ifdef HAVE_SIFT_AVX2
+static int _ccv_sift_avx2 = -1;
+#endif
+
+/* pick the widest kernel the running cpu supports */
+static ccv_sift_dist_f _ccv_sift_dist_select(int type, int norm)
+{
+	int u8 = (CCV_GET_DATA_TYPE(type) == CCV_8U);
+	int l1 = (norm == CCV_L1_NORM);
+#ifdef HAVE_SIFT_AVX2
+	if (_ccv_sift_avx2 < 0)
+	{
+		__builtin_cpu_init();
+		_ccv_sift_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+	if (_ccv_sift_avx2)
+		return u8 ? (l1 ? _ccv_sift_l1_8u_avx2 : _ccv_sift_l2_8u_avx2) : _ccv_sift_l2_avx2;
+#endif
+#ifdef HAVE_SSE2
+	return u8 ? (l1 ? _ccv_sift_l1_8u_sse2 : _ccv_sift_l2_8u_sse2) : _ccv_sift_l2_sse2;
+#else
+	return u8 ? (l1 ? _ccv_sift_l1_8u_scalar : _ccv_sift_l2_8u_scalar) : _ccv_sift_l2_scalar;
+#endif
+}
+
+static void _ccv_sift_kd_descend(ccv_sift_index_t* index, ccv_sift_kd_search_t* s, int tree, int nid, float mindist)
+{
+	ccv_sift_kd_node_t* node = (ccv_sift_kd_node_t*)ccv_array_get(index->nodes, nid);
+	while (node->dim >= 0)
+	{
+		float diff = s->query[node->dim] - node->value;
+		int near = diff < 0 ? node->left : node->right;
+		int far = diff < 0 ? node->right : node->left;
+		float dist = mindist + (s->l1 ? fabsf(diff) : diff * diff);
+		if (dist < s->mind2)
+		{
+			ccv_sift_kd_branch_t branch = {
+				.dist = dist,
+				.node = far,
+				.tree = tree,
+			};
+			_ccv_sift_kd_heap_push(s, branch);
+		}
+		node = (ccv_sift_kd_node_t*)ccv_array_get(index->nodes, near);
+	}
+	if (s->checked >= s->checks && s->minj >= 0)
+		return;
+	int i;
+	int* idx = index->idx + tree * index->rnum;
+	for (i = node->left; i < node->right; i++)
+	{
+		int j = idx[i];
+		if (s->visited[j] == s->stamp)
+			continue;
+		s->visited[j] = s->stamp;
+		++s->checked;
+		float d = s->dist(s->row, s->desc + (size_t)j * s->step, s->mind2);
+		if (d < s->mind)
+		{
+			s->mind2 = s->mind;
+			s->mind = d;
+			s->minj = j;
+		} else if (d < s->mind2)
+			s->mind2 = d;
+	}
+}
+
+ccv_array_t* ccv_sift_match(ccv_dense_matrix_t* a, ccv_dense_matrix_t* b, ccv_sift_index_t* index, ccv_sift_match_param_t params)
+{
+	int type = CCV_GET_DATA_TYPE(a->type);
+	assert((type == CCV_32F || type == CCV_8U) && a->cols == 128);
+	assert(CCV_GET_DATA_TYPE(b->type) == type && b->cols == 128);
+	assert(params.norm != CCV_L1_NORM || type == CCV_8U);
+	assert(!index || index->rnum == b->rows);
+	ccv_array_t* matches = ccv_array_new(sizeof(ccv_sift_match_t), 64, 0);
+	/* the ratio applies to distances, the squared L2 distance needs it squared as well */
+	double threshold = params.norm == CCV_L1_NORM ? params.ratio : params.ratio * params.ratio;
+	ccv_sift_dist_f dist = _ccv_sift_dist_select(type, params.norm);
+	int i, j;
+	if (!index || params.checks <= 0 || params.checks >= b->rows)
+	{
+		/* exhaustive search, cheaper than the index for small scenes */
+		for (i = 0; i < a->rows; i++)
+		{
+			unsigned char* odesc = a->data.u8 + (size_t)i * a->step;
+			int minj = -1;
+			float mind = FLT_MAX, mind2 = FLT_MAX;
+			for (j = 0; j < b->rows; j++)
+			{
+				float d = dist(odesc, b->data.u8 + (size_t)j * b->step, mind2);
+				if (d < mind)
+				{
+					mind2 = mind;
+					mind = d;
+					minj = j;
+				} else if (d < mind2) {
+					mind2 = d;
+				}
+			}
+			if (mind < mind2 * threshold)
+			{
+				ccv_sift_match_t match = {
+					.object = i,
+					.scene = minj,
+					.distance = mind,
+				};
+				ccv_array_push(matches, &match);
+			}
+		}
+		return matches;
+	}
+	float query[128];
+	ccv_sift_kd_search_t s = {
+		.desc = b->data.u8,
+		.step = b->step,
+		.dist = dist,
+		.l1 = params.norm == CCV_L1_NORM,
+		.visited = (int*)ccmalloc(sizeof(int) * b->rows),
+		.stamp = 0,
+		.checks = params.checks,
+		.heap_size = 64,
+		.heap = (ccv_sift_kd_branch_t*)ccmalloc(sizeof(ccv_sift_kd_branch_t) * 64),
+	};
+	memset(s.visited, -1, sizeof(int) * b->rows);
+	for (i = 0; i < a->rows; i++)
+	{
+		s.row = a->data.u8 + (size_t)i * a->step;
+		if (type == CCV_8U)
+		{
+			/* the trees split on float values */
+			for (j = 0; j < 128; j++)
+				query[j] = s.row[j];
+			s.query = query;
+		} else
+			s.query = (const float*)s.row;
+		s.stamp = i;
+		s.checked = 0;
+		s.heap_rnum = 0;
+		s.mind = s.mind2 = FLT_MAX;
+		s.minj = -1;
+		for (j = 0; j < index->trees; j++)
+			_ccv_sift_kd_descend(index, &s, j, index->root[j], 0);
+		while (s.heap_rnum > 0 && s.checked < s.checks)
+		{
+			ccv_sift_kd_branch_t branch = _ccv_sift_kd_heap_pop(&s);
+			if (branch.dist >= s.mind2)
+				break;
+			_ccv_sift_kd_descend(index, &s, branch.tree, branch.node, branch.dist);
+		}
+		if (s.minj >= 0 && s.mind < s.mind2 * threshold)
+		{
+			ccv_sift_match_t match = {
+				.object = i,
+				.scene = s.minj,
+				.distance = s.mind,
+			};
+			ccv_array_push(matches, &match);
+		}
+	}
+	ccfree(s.visited);
+	ccfree(s.heap);
+	return matches;
+}
+
+/* the file starts with this header, followed by the key-points and then, aligned to 64 bytes, the
+ * descriptor rows. Everything is stored as it is in memory, so the file can be used where it is mapped */
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t type;
+	uint32_t rows;
+	uint32_t cols;
+	uint32_t keypoint_size;
+	uint32_t step;
+} ccv_sift_file_header_t;
+
+#define CCV_SIFT_FILE_MAGIC "CCVSIFTD"
+#define CCV_SIFT_FILE_VERSION (1)
+
+static inline size_t _ccv_sift_file_desc_offset(int rows)
+{
+	return (sizeof(ccv_sift_file_header_t) + (size_t)rows * sizeof(ccv_keypoint_t) + 63) & -64;
+}
+
+int ccv_sift_write(const char* filename, ccv_array_t* keypoints, ccv_dense_matrix_t* desc)
+{
+	assert(keypoints->rnum == desc->rows);
+	assert(keypoints->rsize == sizeof(ccv_keypoint_t));
+	FILE* w = fopen(filename, "wb");
+	if (!w)
+		return CCV_IO_ERROR;
+	ccv_sift_file_header_t header = {
+		.version = CCV_SIFT_FILE_VERSION,
+		.type = CCV_GET_DATA_TYPE(desc->type) | CCV_C1,
+		.rows = desc->rows,
+		.cols = desc->cols,
+		.keypoint_size = sizeof(ccv_keypoint_t),
+		.step = desc->step,
+	};
+	memcpy(header.magic, CCV_SIFT_FILE_MAGIC, 8);
+	static const char padding[64] = {0};
+	size_t offset = _ccv_sift_file_desc_offset(desc->rows);
+	size_t kpsize = sizeof(ccv_keypoint_t) * keypoints->rnum;
+	int ok = fwrite(&header, sizeof(header), 1, w) == 1 &&
+		(kpsize == 0 || fwrite(keypoints->data, kpsize, 1, w) == 1) &&
+		fwrite(padding, 1, offset - sizeof(header) - kpsize, w) == offset - sizeof(header) - kpsize &&
+		((size_t)desc->step * desc->rows == 0 || fwrite(desc->data.u8, (size_t)desc->step * desc->rows, 1, w) == 1);
+	if (fclose(w) != 0)
+		ok = 0;
+	return ok ? CCV_IO_FINAL : CCV_IO_ERROR;
+}
+
+ccv_sift_file_t* ccv_sift_read(const char* filename)
+{
+	void* map = 0;
+	size_t size = 0;
+#ifdef _WIN32
+	FILE* r = fopen(filename, "rb");
+	if (!r)
+		return 0;
+	fseek(r, 0, SEEK_END);
+	size = ftell(r);
+	fseek(r, 0, SEEK_SET);
+	map = ccmalloc(ccv_max(size, 1));
+	if (fread(map, 1, size, r) != size)
+	{
+		ccfree(map);
+		fclose(r);
+		return 0;
+	}
+	fclose(r);
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < sizeof(ccv_sift_file_header_t))
+	{
+		close(fd);
+		return 0;
+	}
+	size = st.st_size;
+	map = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+#endif
+	ccv_sift_file_t* file = (ccv_sift_file_t*)ccmalloc(sizeof(ccv_sift_file_t));
+	file->map = map;
+	file->size = size;
+	ccv_sift_file_header_t* header = (ccv_sift_file_header_t*)map;
+	if (size < sizeof(ccv_sift_file_header_t) ||
+		memcmp(header->magic, CCV_SIFT_FILE_MAGIC, 8) != 0 ||
+		header->version != CCV_SIFT_FILE_VERSION ||
+		header->keypoint_size != sizeof(ccv_keypoint_t) ||
+		header->cols != 128 ||
+		(header->type != (CCV_8U | CCV_C1) && header->type != (CCV_32F | CCV_C1)) ||
+		header->step != CCV_GET_STEP(header->cols, header->type) ||
+		size < _ccv_sift_file_desc_offset(header->rows) + (size_t)header->step * header->rows)
+	{
+		ccv_sift_file_free(file);
+		return 0;
+	}
+	file->keypoints.type = 0;
+	file->keypoints.sig = 0;
+	file->keypoints.refcount = 1;
+	file->keypoints.rnum = file->keypoints.size = header->rows;
+	file->keypoints.rsize = sizeof(ccv_keypoint_t);
+	file->keypoints.data = (unsigned char*)map + sizeof(ccv_sift_file_header_t);
+	file->desc = ccv_dense_matrix(header->rows, header->cols, header->type, (unsigned char*)map + _ccv_sift_file_desc_offset(header->rows), 0);
+	return file;
+}
+
+void ccv_sift_file_free(ccv_sift_file_t* file)
+{
+#ifdef _WIN32
+	ccfree(file->map);
+#else
+	munmap(file->map, file->size);
+#endif
+	ccfree(file);
+}
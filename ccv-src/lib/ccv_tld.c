@@ -882,6 +882,13 @@ static int _ccv_is_equal(const void* _r1, const void* _r2, void* data)
 	return _ccv_tld_rect_intersect(r1->rect, r2->rect) > 0.5;
 }
 
+/* rectangles that don't overlap have no intersection to speak of */
+static int _ccv_is_equal_bound(const void* _r, ccv_rect_t* bound, void* data)
+{
+	*bound = ((const ccv_comp_t*)_r)->rect;
+	return 1;
+}
+
 // since there is no refcount syntax for ccv yet, we won't implicitly retain any matrix in ccv_tld_t
 // instead, you should pass the previous frame and the current frame into the track function
 ccv_comp_t ccv_tld_track_object(ccv_tld_t* tld, ccv_dense_matrix_t* a, ccv_dense_matrix_t* b, ccv_tld_info_t* info)
@@ -937,7 +944,7 @@ ccv_comp_t ccv_tld_track_object(ccv_tld_t* tld, ccv_dense_matrix_t* a, ccv_dense
 	{
 		ccv_array_t* idx_dd = 0;
 		// group retrieved rectangles in order to filter out noise
-		int ncomp = ccv_array_group(dd, &idx_dd, _ccv_is_equal, 0);
+		int ncomp = ccv_array_group_bounded(dd, &idx_dd, _ccv_is_equal, _ccv_is_equal_bound, 0);
 		ccv_comp_t* comps = (ccv_comp_t*)ccmalloc(ncomp * sizeof(ccv_comp_t));
 		memset(comps, 0, ncomp * sizeof(ccv_comp_t));
 		for (i = 0; i < dd->rnum; i++)
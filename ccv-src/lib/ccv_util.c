@@ -1686,6 +1686,58 @@ typedef struct ccv_ptree_node_t
 	int rank;
 } ccv_ptree_node_t;
 
+static inline ccv_ptree_node_t* _ccv_ptree_find(ccv_ptree_node_t* node)
+{
+	ccv_ptree_node_t* root = node;
+	while (root->parent)
+		root = root->parent;
+	/* compress path from node to the root: */
+	while (node->parent)
+	{
+		ccv_ptree_node_t* temp = node;
+		node = node->parent;
+		temp->parent = root;
+	}
+	return root;
+}
+
+static inline void _ccv_ptree_union(ccv_ptree_node_t* root, ccv_ptree_node_t* root2)
+{
+	if (root->rank > root2->rank)
+		root2->parent = root;
+	else {
+		root->parent = root2;
+		root2->rank += root->rank == root2->rank;
+	}
+}
+
+static int _ccv_array_group_index(ccv_ptree_node_t* node, int rnum, ccv_array_t** index)
+{
+	if (*index == 0)
+		*index = ccv_array_new(sizeof(int), rnum, 0);
+	else
+		ccv_array_clear(*index);
+	ccv_array_t* idx = *index;
+
+	int i, j;
+	int class_idx = 0;
+	for(i = 0; i < rnum; i++)
+	{
+		j = -1;
+		ccv_ptree_node_t* node1 = node + i;
+		if(node1->element)
+		{
+			while(node1->parent)
+				node1 = node1->parent;
+			if(node1->rank >= 0)
+				node1->rank = ~class_idx++;
+			j = ~node1->rank;
+		}
+		ccv_array_push(idx, &j);
+	}
+	return class_idx;
+}
+
 /* the code for grouping array is adopted from OpenCV's cvSeqPartition func, it is essentially a find-union algorithm */
 int ccv_array_group(ccv_array_t* array, ccv_array_t** index, ccv_array_group_f gfunc, void* data)
 {
@@ -1701,71 +1753,137 @@ int ccv_array_group(ccv_array_t* array, ccv_array_t** index, ccv_array_group_f g
 	{
 		if (!node[i].element)
 			continue;
-		ccv_ptree_node_t* root = node + i;
-		while (root->parent)
-			root = root->parent;
 		for (j = 0; j < array->rnum; j++)
-		{
-			if( i != j && node[j].element && gfunc(node[i].element, node[j].element, data))
+			if (i != j && node[j].element && gfunc(node[i].element, node[j].element, data))
 			{
-				ccv_ptree_node_t* root2 = node + j;
+				ccv_ptree_node_t* root = _ccv_ptree_find(node + i);
+				ccv_ptree_node_t* root2 = _ccv_ptree_find(node + j);
+				if (root != root2)
+					_ccv_ptree_union(root, root2);
+			}
+	}
+	int class_idx = _ccv_array_group_index(node, array->rnum, index);
+	ccfree(node);
+	return class_idx;
+}
 
-				while(root2->parent)
-					root2 = root2->parent;
+typedef struct {
+	int level;
+	int x;
+	int y;
+	int i;
+} ccv_array_group_cell_t;
 
-				if(root2 != root)
-				{
-					if(root->rank > root2->rank)
-						root2->parent = root;
-					else
-					{
-						root->parent = root2;
-						root2->rank += root->rank == root2->rank;
-						root = root2;
-					}
+#define less_than(c1, c2, aux) ((c1).level < (c2).level || ((c1).level == (c2).level && ((c1).y < (c2).y || ((c1).y == (c2).y && ((c1).x < (c2).x || ((c1).x == (c2).x && (c1).i < (c2).i))))))
+static CCV_IMPLEMENT_QSORT(_ccv_array_group_cell_qsort, ccv_array_group_cell_t, less_than)
+#undef less_than
 
-					/* compress path from node2 to the root: */
-					ccv_ptree_node_t* node2 = node + j;
-					while(node2->parent)
-					{
-						ccv_ptree_node_t* temp = node2;
-						node2 = node2->parent;
-						temp->parent = root;
-					}
+/* merge i and j if they are not in the same group already and gfunc says they should be, in either order, like ccv_array_group does */
+static inline void _ccv_array_group_try(ccv_ptree_node_t* node, int i, int j, ccv_array_group_f gfunc, void* data)
+{
+	ccv_ptree_node_t* root = _ccv_ptree_find(node + i);
+	ccv_ptree_node_t* root2 = _ccv_ptree_find(node + j);
+	if (root != root2 && (gfunc(node[i].element, node[j].element, data) || gfunc(node[j].element, node[i].element, data)))
+		_ccv_ptree_union(root, root2);
+}
 
-					/* compress path from node to the root: */
-					node2 = node + i;
-					while(node2->parent)
-					{
-						ccv_ptree_node_t* temp = node2;
-						node2 = node2->parent;
-						temp->parent = root;
-					}
-				}
-			}
-		}
+/* first cell in the sorted cells that is not less than (level, x, y) */
+static int _ccv_array_group_cell_find(const ccv_array_group_cell_t* cell, int count, int level, int x, int y)
+{
+	int low = 0, high = count;
+	while (low < high)
+	{
+		int mid = (low + high) >> 1;
+		if (cell[mid].level < level || (cell[mid].level == level && (cell[mid].y < y || (cell[mid].y == y && cell[mid].x < x))))
+			low = mid + 1;
+		else
+			high = mid;
 	}
-	if (*index == 0)
-		*index = ccv_array_new(sizeof(int), array->rnum, 0);
-	else
-		ccv_array_clear(*index);
-	ccv_array_t* idx = *index;
+	return low;
+}
 
-	int class_idx = 0;
-	for(i = 0; i < array->rnum; i++)
+/* every bounded element goes into the grid cell of its top left corner, on the level whose cell size is the first power
+ * of two no smaller than its bounding box. An element only looks for partners on its own level and the ones above, where
+ * anything that overlaps it has its corner within the 3x3 cells around; smaller partners find it from their side. */
+int ccv_array_group_bounded(ccv_array_t* array, ccv_array_t** index, ccv_array_group_f gfunc, ccv_array_bound_f bfunc, void* data)
+{
+	int i, j, k, c, y;
+	ccv_ptree_node_t* node = (ccv_ptree_node_t*)ccmalloc(array->rnum * sizeof(ccv_ptree_node_t));
+	ccv_rect_t* bound = (ccv_rect_t*)ccmalloc(array->rnum * sizeof(ccv_rect_t));
+	ccv_array_group_cell_t* cell = (ccv_array_group_cell_t*)ccmalloc(array->rnum * sizeof(ccv_array_group_cell_t));
+	int* unbounded = (int*)ccmalloc(array->rnum * sizeof(int));
+	int cell_count = 0, unbounded_count = 0;
+	int min_x = 0, min_y = 0;
+	for (i = 0; i < array->rnum; i++)
 	{
-		j = -1;
-		ccv_ptree_node_t* node1 = node + i;
-		if(node1->element)
+		node[i].parent = 0;
+		node[i].element = ccv_array_get(array, i);
+		node[i].rank = 0;
+		if (!node[i].element)
+			continue;
+		if (!bfunc(node[i].element, bound + i, data))
 		{
-			while(node1->parent)
-				node1 = node1->parent;
-			if(node1->rank >= 0)
-				node1->rank = ~class_idx++;
-			j = ~node1->rank;
+			unbounded[unbounded_count++] = i;
+			continue;
 		}
-		ccv_array_push(idx, &j);
+		bound[i].width = ccv_max(bound[i].width, 0);
+		bound[i].height = ccv_max(bound[i].height, 0);
+		if (cell_count == 0 || bound[i].x < min_x)
+			min_x = bound[i].x;
+		if (cell_count == 0 || bound[i].y < min_y)
+			min_y = bound[i].y;
+		cell[cell_count++].i = i;
+	}
+	int max_level = 0;
+	for (k = 0; k < cell_count; k++)
+	{
+		i = cell[k].i;
+		bound[i].x -= min_x;
+		bound[i].y -= min_y;
+		int level = 0;
+		while (level < 30 && (1 << level) < ccv_max(bound[i].width, bound[i].height))
+			++level;
+		max_level = ccv_max(max_level, level);
+		cell[k].level = level;
+		cell[k].x = bound[i].x >> level;
+		cell[k].y = bound[i].y >> level;
+	}
+	_ccv_array_group_cell_qsort(cell, cell_count, 0);
+	for (k = 0; k < cell_count; k++)
+	{
+		i = cell[k].i;
+		int level;
+		for (level = cell[k].level; level <= max_level; level++)
+		{
+			int x0 = ccv_max(bound[i].x - (1 << level), 0) >> level;
+			int x1 = (bound[i].x + bound[i].width) >> level;
+			int y0 = ccv_max(bound[i].y - (1 << level), 0) >> level;
+			int y1 = (bound[i].y + bound[i].height) >> level;
+			for (y = y0; y <= y1; y++)
+				for (c = _ccv_array_group_cell_find(cell, cell_count, level, x0, y); c < cell_count && cell[c].level == level && cell[c].y == y && cell[c].x <= x1; c++)
+				{
+					j = cell[c].i;
+					// pairs on the same level are seen from both sides, only take them once
+					if (level == cell[k].level && j >= i)
+						continue;
+					if (bound[j].x <= bound[i].x + bound[i].width && bound[i].x <= bound[j].x + bound[j].width &&
+						bound[j].y <= bound[i].y + bound[i].height && bound[i].y <= bound[j].y + bound[j].height)
+						_ccv_array_group_try(node, i, j, gfunc, data);
+				}
+		}
+	}
+	// whatever cannot be bounded is compared against everything
+	for (k = 0; k < unbounded_count; k++)
+	{
+		i = unbounded[k];
+		for (j = 0; j < array->rnum; j++)
+			if (i != j && node[j].element)
+				_ccv_array_group_try(node, i, j, gfunc, data);
 	}
+	ccfree(unbounded);
+	ccfree(cell);
+	ccfree(bound);
+	int class_idx = _ccv_array_group_index(node, array->rnum, index);
 	ccfree(node);
 	return class_idx;
 }
@@ -1828,3 +1946,90 @@ void ccv_contour_free(ccv_contour_t* contour)
 		ccv_array_free(contour->set);
 	ccfree(contour);
 }
+
+const ccv_detect_video_param_t ccv_detect_video_default_params = {
+	.interval = 8,
+	.margin = 0.5,
+	.scale = 1.5,
+};
+
+ccv_detect_video_t* ccv_detect_video_new(ccv_detect_video_param_t params)
+{
+	assert(params.interval >= 1 && params.margin >= 0 && params.scale >= 1);
+	ccv_detect_video_t* video = (ccv_detect_video_t*)ccmalloc(sizeof(ccv_detect_video_t));
+	video->params = params;
+	video->frame = 0;
+	video->seq = ccv_array_new(sizeof(ccv_comp_t), 16, 0);
+	return video;
+}
+
+static inline int _ccv_rect_is_overlapping(ccv_rect_t r1, ccv_rect_t r2)
+{
+	return r1.x < r2.x + r2.width && r2.x < r1.x + r1.width && r1.y < r2.y + r2.height && r2.y < r1.y + r1.height;
+}
+
+ccv_array_t* ccv_detect_video_regions(ccv_detect_video_t* video, ccv_rect_t roi, ccv_size_t min_size, ccv_size_t max_size)
+{
+	int full = video->params.interval <= 1 || video->frame % video->params.interval == 0;
+	++video->frame;
+	if (full)
+		return 0;
+	int i, j;
+	ccv_array_t* regions = ccv_array_new(sizeof(ccv_detect_video_region_t), video->seq->rnum, 0);
+	for (i = 0; i < video->seq->rnum; i++)
+	{
+		ccv_comp_t* comp = (ccv_comp_t*)ccv_array_get(video->seq, i);
+		int mx = (int)(comp->rect.width * video->params.margin + 0.5);
+		int my = (int)(comp->rect.height * video->params.margin + 0.5);
+		int x = ccv_max(comp->rect.x - mx, roi.x);
+		int y = ccv_max(comp->rect.y - my, roi.y);
+		int width = ccv_min(comp->rect.x + comp->rect.width + mx, roi.x + roi.width) - x;
+		int height = ccv_min(comp->rect.y + comp->rect.height + my, roi.y + roi.height) - y;
+		if (width <= 0 || height <= 0)
+			continue;
+		ccv_detect_video_region_t region = {
+			.roi = ccv_rect(x, y, width, height),
+			.min_size = ccv_size(ccv_max((int)(comp->rect.width / video->params.scale), min_size.width), ccv_max((int)(comp->rect.height / video->params.scale), min_size.height)),
+			.max_size = ccv_size((int)(comp->rect.width * video->params.scale + 0.5), (int)(comp->rect.height * video->params.scale + 0.5)),
+		};
+		if (max_size.width > 0 && max_size.height > 0)
+			region.max_size = ccv_size(ccv_min(region.max_size.width, max_size.width), ccv_min(region.max_size.height, max_size.height));
+		// a region that overlaps others takes them in, so that no window is scanned twice
+		for (j = 0; j < regions->rnum;)
+		{
+			ccv_detect_video_region_t* other = (ccv_detect_video_region_t*)ccv_array_get(regions, j);
+			if (!_ccv_rect_is_overlapping(region.roi, other->roi))
+			{
+				j++;
+				continue;
+			}
+			x = ccv_min(region.roi.x, other->roi.x);
+			y = ccv_min(region.roi.y, other->roi.y);
+			width = ccv_max(region.roi.x + region.roi.width, other->roi.x + other->roi.width) - x;
+			height = ccv_max(region.roi.y + region.roi.height, other->roi.y + other->roi.height) - y;
+			region.roi = ccv_rect(x, y, width, height);
+			region.min_size = ccv_size(ccv_min(region.min_size.width, other->min_size.width), ccv_min(region.min_size.height, other->min_size.height));
+			region.max_size = ccv_size(ccv_max(region.max_size.width, other->max_size.width), ccv_max(region.max_size.height, other->max_size.height));
+			// the grown region may overlap the ones it was already checked against
+			memcpy(other, ccv_array_get(regions, regions->rnum - 1), sizeof(ccv_detect_video_region_t));
+			--regions->rnum;
+			j = 0;
+		}
+		ccv_array_push(regions, &region);
+	}
+	return regions;
+}
+
+void ccv_detect_video_update(ccv_detect_video_t* video, ccv_array_t* seq)
+{
+	int i;
+	ccv_array_clear(video->seq);
+	for (i = 0; i < seq->rnum; i++)
+		ccv_array_push(video->seq, ccv_array_get(seq, i));
+}
+
+void ccv_detect_video_free(ccv_detect_video_t* video)
+{
+	ccv_array_free(video->seq);
+	ccfree(video);
+}
@@ -2,11 +2,14 @@ package Image::CCV;
 use Exporter 'import';
 require DynaLoader;
 use Carp qw(croak);
-use vars qw($VERSION @EXPORT @ISA);
+use vars qw($VERSION @EXPORT @EXPORT_OK @ISA);
 
 $VERSION = '0.11';
 
 @EXPORT = qw(sift detect_faces );
+@EXPORT_OK = qw(get_sift_descriptor default_sift_params
+                write_sift_descriptor read_sift_descriptor
+                cache_enable cache_drain cache_disable cache_stats);
 
 @ISA = qw(DynaLoader);
 
@@ -25,8 +28,7 @@ Image::CCV - Crazy-cool Computer Vision bindings for Perl
 
 =head1 ALPHA WARNING
 
-This code is very, very rough. It leaks memory left and right
-and the API is very much in flux. But as I got easy results using
+This code is very, very rough and the API is very much in flux. But as I got easy results using
 this code already, I am releasing it as is and will improve it and
 the API as I go along.
 
@@ -34,10 +36,50 @@ See also L<http://libccv.org> for the C<libccv> website.
 
 =cut
 
-# TODO: Make ccv_array_t into a class, so automatic destruction works
-# TODO: ccv_sift_param_t currently leaks. Add a DESTROY method.
-# TODO: Turn C structs into Perl classes for memory management
-#       BBF parameters: ccv_bbf_param_t
+=head1 IMAGES
+
+All functions taking an image accept it in one of three forms:
+
+=over 4
+
+=item *
+
+A plain string is the name of a PNG, JPEG or BMP file:
+
+    detect_faces( 'sample.png' );
+
+=item *
+
+A reference to a scalar holding the contents of such a file. This
+avoids writing uploaded images to disk just to pass them in:
+
+    detect_faces( \$jpeg_bytes );
+
+=item *
+
+A hash reference describing raw pixels:
+
+    detect_faces({
+        data     => $pixels,
+        width    => 640,
+        height   => 480,
+        format   => 'gray', # or rgb, bgr, rgba, bgra, argb, abgr
+        scanline => 640,    # optional, bytes per row
+    });
+
+Grayscale pixels are used in place without copying. All other
+formats get converted to grayscale first.
+
+=item *
+
+An L<Image::CCV::Matrix>, which is an image that has already been
+decoded. Use this to run several functions on the same image:
+
+    my $scene = Image::CCV::Matrix->new( \$jpeg_bytes );
+    my @faces = detect_faces( $scene );
+    my @matches = sift( $object, $scene );
+
+=back
 
 =head1 FUNCTIONS
 
@@ -80,6 +122,8 @@ peak_threshold - peak threshold
 
 sub default_sift_params {
     my ($params) = @_;
+    return $params
+        if ref $params eq 'ccv_sift_param_tPtr';
     $params ||= {};
 
     my %default = (
@@ -116,21 +160,85 @@ sub default_sift_params {
 =head2 C<< get_sift_descriptor( $image, $parameters ); >>
 
     my $desc = get_sift_descriptor('image.png');
-    print for @{ $desc->{keypoints} };
+    print "@$_\n" for $desc->{keypoints}->points;
+
+Returns a hashref with the SIFT keypoints as an L<Image::CCV::Array>
+and their descriptors as an L<Image::CCV::Matrix>.
 
-B<Not yet implemented>
+In addition to the keys of L</default_sift_params>, C<$parameters> can
+contain C<quantize>. If it is true, every descriptor is stored in 128 bytes
+instead of 128 floats. Quantized descriptors take a quarter of the memory,
+match faster and can only be matched against other quantized descriptors.
 
 =cut
 
 sub get_sift_descriptor {
-    my ($filename, $params) = @_;
+    my ($image, $params) = @_;
 
-    $params = default_sift_params( $params );
+    my $quantize = ref $params eq 'HASH' && $params->{ quantize };
+    _get_sift_descriptor( $image, default_sift_params( $params ), $quantize )
+}
+
+sub _get_sift_descriptor {
+    my ($image, $params, $quantize) = @_;
+
+    my ($keypoints, $descriptor) = myccv_get_descriptor($image, $params, $quantize ? 1 : 0);
+    return {
+    	keypoints => Image::CCV::Array->_wrap( $keypoints ),
+    	descriptor => Image::CCV::Matrix->_wrap( $descriptor ),
+    }
+}
 
-    my ($keypoints, $descriptor) = myccv_get_descriptor($filename);
+sub _sift_descriptor {
+    my ($image, $params, $quantize) = @_;
+
+    return $image
+        if ref $image eq 'HASH' and $image->{descriptor};
+
+    _get_sift_descriptor( $image, default_sift_params( $params ), $quantize )
+}
+
+=head2 C<< write_sift_descriptor( $desc, $filename ) >>
+
+    write_sift_descriptor( get_sift_descriptor('image.png'), 'image.sift' );
+
+Stores the keypoints and descriptors returned by L</get_sift_descriptor>
+in a file. C<$desc> can also be an image, its descriptors get computed
+with the default parameters then.
+
+The file is a copy of the data as it is held in memory, so it can only be read
+on machines with the same byte order and C<ccv> structure layout.
+
+=cut
+
+sub write_sift_descriptor {
+    my ($desc, $filename) = @_;
+
+    $desc = _sift_descriptor( $desc );
+    myccv_sift_write( $desc->{keypoints}->{array}, $desc->{descriptor}->{matrix}, $filename )
+        or croak "Couldn't write SIFT features to '$filename': $!";
+}
+
+=head2 C<< read_sift_descriptor( $filename ) >>
+
+    my $desc = read_sift_descriptor( 'image.sift' );
+    my @common_features = sift( 'object.png', $desc );
+
+Returns the keypoints and descriptors stored by L</write_sift_descriptor>
+in the same form as L</get_sift_descriptor>. The file is mapped into memory
+and used in place, so reading it costs next to nothing, even for large
+collections of images. The file stays mapped as long as the keypoints or
+the descriptors are in use.
+
+=cut
+
+sub read_sift_descriptor {
+    my ($filename) = @_;
+
+    my ($file, $keypoints, $descriptor) = myccv_sift_read( $filename );
     return {
-    	keypoints => $keypoints,
-    	descriptor => $descriptor,
+    	keypoints => Image::CCV::Array->_wrap( $keypoints, $file ),
+    	descriptor => Image::CCV::Matrix->_wrap( $descriptor, $file ),
     }
 }
 
@@ -145,18 +253,105 @@ Returns a list of 4-element arrayrefs. The elements are:
     scene-x
     scene-y
 
-The parameters get decoded by C<get_default_params>.
+C<$object> and C<$scene> are images or the results of L</get_sift_descriptor>
+or L</read_sift_descriptor>.
+
+The parameters get decoded by C<get_default_params>. Additionally,
+the following keys control how the descriptors get matched:
+
+=over 4
+
+=item *
+
+trees - number of randomized kd-trees indexing the scene descriptors, defaults to 4
+
+=item *
+
+checks - maximum number of scene descriptors compared per object descriptor,
+defaults to 256. Higher values find more true matches but take longer.
+C<0> compares against every scene descriptor.
+
+=item *
+
+ratio - a match is accepted if it is closer than C<ratio> times the second
+best candidate, defaults to 0.6
+
+=item *
+
+quantize - compute descriptors of 128 bytes instead of 128 floats, see
+L</get_sift_descriptor>. Defaults to false unless C<norm> is C<l1>.
+
+=item *
+
+norm - C<l2> compares descriptors by their euclidean distance, C<l1>
+by the sum of their absolute differences, which needs quantized descriptors.
+Defaults to C<l2>.
+
+=back
+
+The index is only built if the scene has more descriptors than C<checks>,
+otherwise all descriptors get compared. Use L<Image::CCV::SIFT::Index> to
+match several objects against the same scene.
 
 =cut
 
 sub sift {
     my ($object, $scene, $params) = @_;
 
+    my %match = default_match_params( $params );
     $params = default_sift_params( $params );
 
-    myccv_sift( $object, $scene, $params);
+    if( grep { ref $_ eq 'HASH' and $_->{descriptor} } $object, $scene ) {
+        $object = _sift_descriptor( $object, $params, $match{ quantize });
+        $scene = _sift_descriptor( $scene, $params, $match{ quantize });
+
+        my $index;
+        if( $match{ trees } > 0 and $match{ checks } > 0
+            and $match{ checks } < $scene->{descriptor}->rows ) {
+            $index = myccv_sift_index_new( $scene->{descriptor}->{matrix}, $match{ trees });
+        };
+        return myccv_sift_match(
+            $object->{keypoints}->{array}, $object->{descriptor}->{matrix},
+            $scene->{keypoints}->{array}, $scene->{descriptor}->{matrix},
+            $index, $match{ checks }, $match{ ratio }, _norm( $match{ norm }),
+        );
+    };
+
+    myccv_sift( $object, $scene, $params, @match{qw<trees checks ratio quantize>}, _norm( $match{ norm }));
 };
 
+sub default_match_params {
+    my ($params) = @_;
+    my %match = (
+        trees  => 4,
+        checks => 256,
+        ratio  => 0.6,
+        norm   => 'l2',
+    );
+    if( ref $params eq 'HASH' ) {
+        for (keys %match, 'quantize') {
+            $match{ $_ } = $params->{ $_ }
+                if exists $params->{ $_ };
+        };
+    };
+    $match{ quantize } = $match{ norm } eq 'l1'
+        unless defined $match{ quantize };
+    $match{ quantize } = $match{ quantize } ? 1 : 0;
+    %match
+}
+
+# The values of CCV_L1_NORM and CCV_L2_NORM
+my %norm = (
+    l1 => 1,
+    l2 => 2,
+);
+
+sub _norm {
+    my ($norm) = @_;
+    $norm{ lc $norm }
+        or croak "Unknown norm '$norm', use 'l1' or 'l2'";
+}
+
 =head2 C<< detect_faces( $png_file ) >>
 
     my @faces = detect_faces('sample.png');
@@ -169,24 +364,104 @@ Returns a list of 5-element arrayrefs. The elements are:
     height
     confidence
 
+The classifier cascade is loaded on the first call and kept for all
+later calls using the same training data. See L<Image::CCV::BBF>
+if you want to control the detection parameters.
+
 =cut
 
+my %bbf_cascade;
+
 sub detect_faces {
     my ($filename, $training_data_path) = @_;
 
-    if(! $training_data_path ) {
-    	($training_data_path = $INC{ "Image/CCV.pm" }) =~ s!.pm$!!;
-    	$training_data_path .= '/facedetect';
-    };
+    $training_data_path ||= Image::CCV::BBF->default_cascade;
 
-    if( ! -d $training_data_path ) {
-    	croak "Training data path '$training_data_path' does not seem to be a directory!";
-    };
-    myccv_detect_faces($filename, $training_data_path);
+    $bbf_cascade{ $training_data_path } ||= Image::CCV::BBF->new(
+        cascade => $training_data_path,
+    );
+    $bbf_cascade{ $training_data_path }->detect( $filename );
+}
+
+=head1 CACHE
+
+C<ccv> keeps intermediate results like image pyramids in a cache keyed
+by a signature of the input image and the operation. Running the same
+operation on the same image again recycles the cached result instead
+of recomputing it. The cache is enabled with its default size of 64MiB
+when the module is loaded and lives as long as the process.
+
+The cache belongs to the thread that enabled it. Other threads run
+without a cache until they call C<cache_enable> themselves.
+
+=head2 C<< cache_enable( $bytes ) >>
+
+    cache_enable( 256 * 1024 * 1024 );
+
+(Re)enables the cache, bounded to C<$bytes>. Defaults to 64MiB.
+Objects cached so far are discarded.
+
+=cut
+
+sub cache_enable {
+    my ($bytes) = @_;
+    $bytes ||= 64 * 1024 * 1024;
+    myccv_enable_cache( $bytes );
+}
+
+=head2 C<< cache_drain() >>
+
+Releases all cached objects but keeps the cache enabled.
+
+=cut
+
+sub cache_drain {
+    myccv_drain_cache();
+}
+
+=head2 C<< cache_disable() >>
+
+Releases all cached objects and disables the cache.
+
+=cut
+
+sub cache_disable {
+    myccv_disable_cache();
+}
+
+=head2 C<< cache_stats() >>
+
+    my $stats = cache_stats();
+    printf "%d hits, %d misses\n", @{$stats}{qw(hits misses)};
+
+Returns a hashref describing the cache of the current thread:
+
+    enabled - whether the cache is enabled
+    limit   - the upper bound in bytes
+    size    - the bytes currently held by cached objects
+    objects - the number of cached objects
+    hits    - how many results were recycled from the cache
+    misses  - how many results had to be computed
+
+C<hits> and C<misses> count since the process started.
+
+=cut
+
+sub cache_stats {
+    my %stats;
+    @stats{qw(enabled limit size objects hits misses)} = myccv_cache_stat();
+    \%stats
 }
 
 Image::CCV->bootstrap();
 
+cache_enable();
+
+require Image::CCV::Matrix;
+require Image::CCV::Array;
+require Image::CCV::BBF;
+require Image::CCV::SIFT::Index;
+
 1;
 
 =head1 LIMITATIONS
@@ -195,19 +470,19 @@ Due to the early development stages, there are several limitations.
 
 =head2 Limited data transfer
 
-Currently, the only mechanism to pass in image data to C<ccv> is by loading
-grayscale PNG or JPEG images from disk. The plan is to also be able to pass
-in image data as scalars or L<Imager> objects.
+Image data can be passed to C<ccv> as files, as encoded image data in
+scalars or as raw pixels (see L</IMAGES>). There is no direct support
+for L<Imager> objects yet.
 
 =head2 Limited result storage
 
-Currently, there is no implemented way to store the results of applying
-the SIFT algorithm to an image. This makes searching several images for the
-same object slow and inconvenient.
+SIFT results can be stored with L</write_sift_descriptor>, but the files
+are not portable between machines of different architecture.
 
 =head2 Limited memory management
 
-Memory currently is only allocated. Rarely is memory deallocated.
+Classifier cascades, decoded images and SIFT results are wrapped in
+objects that release their memory once they go out of scope.
 
 =head1 REPOSITORY
 
@@ -240,6 +515,10 @@ or via mail to L<image-ccv-Bugs@rt.cpan.org>.
 Compilation requires -dev header libraries, so make sure you have (at the time of writing, on *nix)
 I<libjpeg8-dev> and I<libpng12-dev> installed.
 
+Set C<CCV_OPENMP=1> in the environment when running C<perl Makefile.PL>
+to build with OpenMP. Face detection then spreads the image pyramid and
+the scan across all cores.
+
 =head1 AUTHOR
 
 Max Maischein C<corion@cpan.org>
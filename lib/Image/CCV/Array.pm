@@ -0,0 +1,76 @@
+package Image::CCV::Array;
+use strict;
+require Image::CCV;
+
+use vars qw($VERSION);
+$VERSION = '0.11';
+
+=head1 NAME
+
+Image::CCV::Array - a list of results computed by ccv
+
+=head1 SYNOPSIS
+
+    use Image::CCV qw(get_sift_descriptor);
+
+    my $desc = get_sift_descriptor( 'image.png' );
+    print $desc->{keypoints}->count, " keypoints\n";
+    print "@$_\n" for $desc->{keypoints}->points;
+
+=head1 DESCRIPTION
+
+This class holds a C<ccv_array_t>, for example the keypoints
+found by L<Image::CCV/get_sift_descriptor>. The array is released
+once the last reference to the object goes away.
+
+=head1 METHODS
+
+=cut
+
+sub _wrap {
+    my ($class, $array, $owner) = @_;
+    bless {
+        array => $array,
+        owner => $owner,
+    } => $class
+}
+
+# Arrays pointing into memory that belongs to their owner, like the
+# keypoints of a mapped SIFT feature file. The owner frees them.
+@ccv_array_tView::ISA = 'ccv_array_tPtr';
+sub ccv_array_tView::DESTROY {}
+
+=head2 C<< $array->count >>
+
+Returns the number of elements.
+
+=cut
+
+sub count { Image::CCV::myccv_array_count( $_[0]->{array} ) }
+
+=head2 C<< $keypoints->points >>
+
+Returns the keypoints as a list of 2-element arrayrefs. The elements are:
+
+    x
+    y
+
+=cut
+
+sub points { @{ Image::CCV::myccv_keypoints_to_list( $_[0]->{array} ) } }
+
+1;
+
+=head1 AUTHOR
+
+Max Maischein C<corion@cpan.org>
+
+=head1 COPYRIGHT (c)
+
+Copyright 2012-2017 by Max Maischein C<corion@cpan.org>.
+
+=head1 LICENSE
+
+This module is released under the same terms as Perl itself.
+
+=cut
@@ -0,0 +1,306 @@
+package Image::CCV::BBF;
+use strict;
+use Carp qw(croak);
+require Image::CCV;
+
+use vars qw($VERSION);
+$VERSION = '0.11';
+
+=head1 NAME
+
+Image::CCV::BBF - reusable BBF classifier cascade
+
+=head1 SYNOPSIS
+
+    use Image::CCV::BBF;
+
+    my $detector = Image::CCV::BBF->new();
+    for my $scene (@ARGV) {
+        my @faces = $detector->detect( $scene, min_neighbors => 3 );
+        print "@$_\n" for @faces;
+    };
+
+=head1 DESCRIPTION
+
+Loading a BBF cascade means parsing C<cascade.txt> and every
+C<stage-N.txt> file of the training data directory. This class
+loads the cascade once and keeps it around until the object
+goes out of scope, so detecting objects in many images only
+pays for the detection itself.
+
+A cascade can also be saved to a single binary file with
+L</save>. Such a file gets memory-mapped and used in place
+instead of being parsed, and processes that load the same
+file, like forked workers, share its pages.
+
+=head1 METHODS
+
+=head2 C<< Image::CCV::BBF->new( %options ) >>
+
+    my $detector = Image::CCV::BBF->new(
+        cascade => '/path/to/training/data',
+    );
+
+Loads the classifier cascade. Valid keys for C<%options> are:
+
+=over 4
+
+=item *
+
+cascade - the directory containing C<cascade.txt> and the
+C<stage-N.txt> files, or a file written by L</save>.
+Defaults to the face detection cascade distributed with
+this module.
+
+=back
+
+=cut
+
+sub default_cascade {
+    (my $path = $INC{ "Image/CCV.pm" }) =~ s!.pm$!!;
+    "$path/facedetect"
+}
+
+sub new {
+    my ($class, %options) = @_;
+
+    $options{ cascade } ||= $class->default_cascade;
+
+    my ($file, $cascade);
+    if( -f $options{ cascade }) {
+        # The cascade points into the mapped file, which has to stay around
+        ($file, $cascade) = Image::CCV::myccv_bbf_read_classifier_cascade_file( $options{ cascade } );
+
+    } elsif( -d $options{ cascade }) {
+        $cascade = Image::CCV::myccv_bbf_read_classifier_cascade( $options{ cascade } )
+            or croak "Couldn't read BBF classifier cascade from '$options{ cascade }'";
+
+    } else {
+        croak "Training data path '$options{ cascade }' does not seem to be a directory or a cascade file!";
+    };
+
+    bless {
+        path    => $options{ cascade },
+        file    => $file,
+        cascade => $cascade,
+    } => $class
+}
+
+=head2 C<< $detector->save( $filename ) >>
+
+    Image::CCV::BBF->new( cascade => 'training/face' )->save( 'face.ccvbbf' );
+    my $detector = Image::CCV::BBF->new( cascade => 'face.ccvbbf' );
+
+Writes the cascade to a binary file that C<new> maps into memory.
+The file uses the byte order and structure layout of the machine
+that writes it, other machines refuse to load it.
+C<ccv-src/bin/bbffmt> converts training directories the same way:
+
+    bbffmt ccv-src/samples/face map face.ccvbbf
+
+=cut
+
+sub save {
+    my ($self, $filename) = @_;
+    Image::CCV::myccv_bbf_write_classifier_cascade_file( $self->{cascade}, $filename )
+        or croak "Couldn't write BBF classifier cascade to '$filename': $!";
+    1
+}
+
+=head2 C<< $detector->detect( $image, %params ) >>
+
+    my @objects = $detector->detect( 'sample.png', accurate => 0 );
+
+C<$image> is a filename, a reference to the encoded image data or
+raw pixels, see L<Image::CCV/IMAGES>.
+
+Returns a list of 5-element arrayrefs. The elements are:
+
+    x
+    y
+    width
+    height
+    confidence
+
+Valid keys for C<%params> are:
+
+=over 4
+
+=item *
+
+interval - number of interval images between the full size image
+and the half size one, defaults to 5
+
+=item *
+
+min_neighbors - minimum number of overlapping detections needed
+to report an object. C<0> disables the grouping, defaults to 2
+
+=item *
+
+accurate - boolean, whether to scan 4 spatial variations of each scale,
+defaults to 1
+
+=item *
+
+no_nested - boolean, whether to reject objects nested inside other objects,
+defaults to 0
+
+=item *
+
+size - arrayref of the smallest object size of interest as
+C<< [ $width, $height ] >>, defaults to C<< [24, 24] >>
+
+=item *
+
+min_size - arrayref C<< [ $width, $height ] >>, scales that only find
+smaller objects are skipped. Unlike a larger C<size>, this keeps the
+scales C<size> gives and only drops the small ones
+
+=item *
+
+max_size - arrayref C<< [ $width, $height ] >>, scales that only find
+larger objects are skipped and their images are never computed
+
+=item *
+
+roi - arrayref C<< [ $x, $y, $width, $height ] >>, only objects inside
+this region of the image are searched for. The results are still in
+image co-ordinates
+
+=item *
+
+video - a context from L</video>, for when C<$image> is the next frame
+of a video
+
+=back
+
+=cut
+
+sub detect {
+    my ($self, $image, %params) = @_;
+
+    my %default = (
+        interval      => 5,
+        min_neighbors => 2,
+        accurate      => 1,
+        no_nested     => 0,
+        size          => [24, 24],
+        min_size      => [0, 0],
+        max_size      => [0, 0],
+        roi           => [0, 0, 0, 0],
+        video         => undef,
+    );
+
+    for (keys %default) {
+        if(! exists $params{ $_ }) {
+            $params{ $_ } = $default{ $_ }
+        };
+    };
+
+    Image::CCV::myccv_bbf_detect(
+        $params{ video },
+        $image,
+        $self->{cascade},
+        @params{qw<
+            interval
+            min_neighbors
+            accurate
+            no_nested
+        >},
+        @{ $params{ size } },
+        @{ $params{ min_size } },
+        @{ $params{ max_size } },
+        @{ $params{ roi } },
+    );
+}
+
+=head2 C<< $detector->video( %options ) >>
+
+    my $video = $detector->video( interval => 10 );
+    while( my $frame = next_frame() ) {
+        my @faces = $detector->detect( $frame, video => $video );
+    };
+
+Returns a context for detecting objects in consecutive frames of
+a video. A full scan of the frame happens only every C<interval>
+frames. The frames in between are only scanned around the objects
+found in the frame before, at sizes close to theirs, which is
+several times faster. Objects that newly appear are found at the
+next full scan. Use one context per video stream.
+
+Valid keys for C<%options> are:
+
+=over 4
+
+=item *
+
+interval - scan the whole frame every this many frames, defaults to 8.
+C<1> scans every frame in full. Must be at least C<1>
+
+=item *
+
+margin - how far around an object of the previous frame to look, as
+a fraction of its size, defaults to 0.5. C<0> only looks where the
+object was
+
+=item *
+
+scale - how much larger or smaller than in the previous frame an
+object can get, defaults to 1.5. Must be at least C<1>
+
+=back
+
+=cut
+
+sub video {
+    my ($self, %options) = @_;
+
+    my %default = (
+        interval => 8,
+        margin   => 0.5,
+        scale    => 1.5,
+    );
+
+    for (keys %default) {
+        if(! exists $options{ $_ }) {
+            $options{ $_ } = $default{ $_ }
+        };
+    };
+
+    croak "interval must be at least 1, not $options{ interval }"
+        if $options{ interval } < 1;
+    croak "margin must not be negative, not $options{ margin }"
+        if $options{ margin } < 0;
+    croak "scale must be at least 1, not $options{ scale }"
+        if $options{ scale } < 1;
+
+    Image::CCV::myccv_detect_video_new(
+        @options{qw< interval margin scale >},
+    );
+}
+
+# A cascade that points into a mapped file, the file is freed instead
+@ccv_bbf_classifier_cascade_tView::ISA = 'ccv_bbf_classifier_cascade_tPtr';
+sub ccv_bbf_classifier_cascade_tView::DESTROY {}
+
+1;
+
+=head1 MEMORY MANAGEMENT
+
+The classifier cascade is released once the last reference to the
+object goes away. A cascade file is unmapped at the same time.
+
+=head1 AUTHOR
+
+Max Maischein C<corion@cpan.org>
+
+=head1 COPYRIGHT (c)
+
+Copyright 2012-2017 by Max Maischein C<corion@cpan.org>.
+
+=head1 LICENSE
+
+This module is released under the same terms as Perl itself.
+
+=cut
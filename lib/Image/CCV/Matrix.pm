@@ -0,0 +1,169 @@
+package Image::CCV::Matrix;
+use strict;
+use Carp qw(croak);
+require Image::CCV;
+
+use vars qw($VERSION);
+$VERSION = '0.11';
+
+=head1 NAME
+
+Image::CCV::Matrix - a decoded image
+
+=head1 SYNOPSIS
+
+    use Image::CCV qw(sift detect_faces);
+    use Image::CCV::Matrix;
+
+    my $scene = Image::CCV::Matrix->new( 'sample.png' );
+    my @faces = detect_faces( $scene );
+    my @matches = sift( 'object.png', $scene );
+
+=head1 DESCRIPTION
+
+This class holds an image decoded to grayscale by C<ccv>. Everything
+that takes an image also takes an C<Image::CCV::Matrix>, so an image
+used with several detectors only gets decoded once.
+
+The matrix is released once the last reference to the object goes away.
+
+=head1 METHODS
+
+=head2 C<< Image::CCV::Matrix->new( $image, %options ) >>
+
+    my $matrix = Image::CCV::Matrix->new( \$jpeg_bytes );
+
+Decodes C<$image>, which is a filename, a reference to the encoded
+image data or raw pixels, see L<Image::CCV/IMAGES>. Raw pixels are
+copied, so the source scalar can be changed or released afterwards.
+Valid keys for C<%options> are:
+
+=over 4
+
+=item *
+
+max_dimension - images wider or higher than this get shrunk to fit,
+keeping their aspect ratio. JPEG images are scaled down by 1/2, 1/4
+or 1/8 while decoding already, which is a lot faster for large photos
+than decoding them in full
+
+=back
+
+=cut
+
+sub new {
+    my ($class, $image, %options) = @_;
+
+    return $image
+        if ref $image and eval { $image->isa( __PACKAGE__ ) };
+
+    my $matrix = Image::CCV::myccv_read_matrix( $image, $options{ max_dimension } || 0 )
+        or croak "Couldn't read image";
+
+    $class->_wrap( $matrix )
+}
+
+sub _wrap {
+    my ($class, $matrix, $owner) = @_;
+    bless {
+        matrix => $matrix,
+        owner => $owner,
+    } => $class
+}
+
+# Matrices pointing into memory that belongs to their owner, like the
+# descriptors of a mapped SIFT feature file. The owner frees them.
+@ccv_dense_matrix_tView::ISA = 'ccv_dense_matrix_tPtr';
+sub ccv_dense_matrix_tView::DESTROY {}
+
+=head2 C<< $matrix->cols >>
+
+Returns the width of the matrix.
+
+=cut
+
+sub cols { (Image::CCV::myccv_matrix_dimensions( $_[0]->{matrix} ))[0] }
+
+=head2 C<< $matrix->rows >>
+
+Returns the height of the matrix.
+
+=cut
+
+sub rows { (Image::CCV::myccv_matrix_dimensions( $_[0]->{matrix} ))[1] }
+
+=head2 C<< $matrix->resample( $width, $height, %options ) >>
+
+    my $thumbnail = $matrix->resample( 50, 75 );
+
+Returns a new matrix with the image scaled to C<$width> x C<$height>.
+Valid keys for C<%options> are:
+
+=over 4
+
+=item *
+
+method - C<area> averages the pixels that fall into each new pixel
+and only shrinks images, C<cubic> interpolates bicubically. Defaults
+to C<area> when the image gets smaller in both directions and to
+C<cubic> otherwise
+
+=item *
+
+type - the data type of the new matrix, C<8u> for one byte per pixel,
+C<32s> for native 32-bit integers or C<32f> for native floats.
+Defaults to C<8u>
+
+=back
+
+=cut
+
+my %resample_method = (
+    area  => 0x01,
+    cubic => 0x04,
+);
+
+my %resample_type = (
+    '8u'  => 0x01000,
+    '32s' => 0x02000,
+    '32f' => 0x04000,
+);
+
+sub resample {
+    my ($self, $width, $height, %options) = @_;
+
+    $options{ method } ||= ( $width <= $self->cols and $height <= $self->rows ) ? 'area' : 'cubic';
+    my $method = $resample_method{ $options{ method } }
+        or croak "Unknown resample method '$options{ method }'";
+    my $type = $resample_type{ $options{ type } || '8u' }
+        or croak "Unknown matrix type '$options{ type }'";
+    croak "The area method only shrinks images"
+        if $options{ method } eq 'area' and ( $width > $self->cols or $height > $self->rows );
+
+    ref( $self )->_wrap( Image::CCV::myccv_matrix_resample( $self->{matrix}, $height, $width, $method, $type ))
+}
+
+=head2 C<< $matrix->data >>
+
+Returns the pixels of the matrix as a string, row after row. Each pixel
+takes one byte, or four for a C<32s> or C<32f> matrix.
+
+=cut
+
+sub data { Image::CCV::myccv_matrix_data( $_[0]->{matrix} ) }
+
+1;
+
+=head1 AUTHOR
+
+Max Maischein C<corion@cpan.org>
+
+=head1 COPYRIGHT (c)
+
+Copyright 2012-2017 by Max Maischein C<corion@cpan.org>.
+
+=head1 LICENSE
+
+This module is released under the same terms as Perl itself.
+
+=cut
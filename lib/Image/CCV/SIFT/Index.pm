@@ -0,0 +1,140 @@
+package Image::CCV::SIFT::Index;
+use strict;
+use Carp qw(croak);
+require Image::CCV;
+
+use vars qw($VERSION);
+$VERSION = '0.11';
+
+=head1 NAME
+
+Image::CCV::SIFT::Index - match many objects against one scene
+
+=head1 SYNOPSIS
+
+    use Image::CCV::SIFT::Index;
+
+    my $index = Image::CCV::SIFT::Index->new( 'scene.png', checks => 128 );
+    for my $object (@ARGV) {
+        my @common_features = $index->match( $object );
+        print "$object: " . @common_features . " matches\n";
+    };
+
+=head1 DESCRIPTION
+
+Comparing every object descriptor against every scene descriptor takes
+time proportional to the product of both counts. This class computes
+the SIFT descriptors of a scene once and indexes them in a forest of
+randomized kd-trees, so every object descriptor only gets compared
+against a bounded number of scene descriptors.
+
+=head1 METHODS
+
+=head2 C<< Image::CCV::SIFT::Index->new( $scene, %options ) >>
+
+    my $index = Image::CCV::SIFT::Index->new( \$jpeg_bytes );
+
+C<$scene> is an image (see L<Image::CCV/IMAGES>) or the result of
+L<Image::CCV/get_sift_descriptor> or L<Image::CCV/read_sift_descriptor>.
+Valid keys for C<%options> are:
+
+=over 4
+
+=item *
+
+trees - number of randomized kd-trees, defaults to 4. Must be at least 1
+
+=item *
+
+checks - maximum number of scene descriptors compared per object
+descriptor, defaults to 256. C<0> compares against every scene descriptor.
+
+=item *
+
+ratio - a match is accepted if it is closer than C<ratio> times the
+second best candidate, defaults to 0.6
+
+=item *
+
+quantize, norm - compute quantized descriptors and how to compare them,
+see L<Image::CCV/sift>
+
+=item *
+
+sift - the SIFT parameters, see L<Image::CCV/default_sift_params>
+
+=back
+
+=cut
+
+sub new {
+    my ($class, $scene, %options) = @_;
+
+    %options = (
+        %options,
+        Image::CCV::default_match_params( \%options ),
+    );
+
+    croak "trees must be at least 1, not $options{ trees }"
+        unless $options{ trees } >= 1;
+
+    my $self = bless \%options => $class;
+    $self->{scene} = $self->features( $scene );
+    $self->{index} = Image::CCV::myccv_sift_index_new(
+        $self->{scene}->{descriptor}->{matrix},
+        $self->{trees},
+    );
+    $self
+}
+
+sub features {
+    my ($self, $image) = @_;
+
+    Image::CCV::_sift_descriptor( $image, $self->{sift}, $self->{quantize} );
+}
+
+=head2 C<< $index->match( $object, %options ) >>
+
+    my @common_features = $index->match( 'object.png' );
+
+Returns the same list of 4-element arrayrefs as L<Image::CCV/sift>.
+C<$object> is an image or the result of L<Image::CCV/get_sift_descriptor>
+or L<Image::CCV/read_sift_descriptor>.
+The C<checks> and C<ratio> options override those given to the constructor.
+
+=cut
+
+sub match {
+    my ($self, $object, %options) = @_;
+
+    my $features = $self->features( $object );
+    my $checks = exists $options{ checks } ? $options{ checks } : $self->{checks};
+    my $ratio = exists $options{ ratio } ? $options{ ratio } : $self->{ratio};
+
+    Image::CCV::myccv_sift_match(
+        $features->{keypoints}->{array},
+        $features->{descriptor}->{matrix},
+        $self->{scene}->{keypoints}->{array},
+        $self->{scene}->{descriptor}->{matrix},
+        $self->{index},
+        $checks,
+        $ratio,
+        Image::CCV::_norm( $self->{norm} ),
+    );
+}
+
+1;
+
+=head1 AUTHOR
+
+Max Maischein C<corion@cpan.org>
+
+=head1 COPYRIGHT (c)
+
+Copyright 2012-2017 by Max Maischein C<corion@cpan.org>.
+
+=head1 LICENSE
+
+This module is released under the same terms as Perl itself.
+
+=cut
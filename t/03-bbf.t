@@ -0,0 +1,30 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 7;
+
+use Image::CCV::BBF;
+
+my $scene = 't/face_IMG_0762_bw_small.png';
+
+my $detector = Image::CCV::BBF->new();
+isa_ok $detector, 'Image::CCV::BBF';
+
+my @faces = $detector->detect( $scene );
+is 0+@faces, 1, "We find one face";
+is_deeply [ @{ $faces[0] }[0..3] ], [37, 33, 26, 26], "... at the expected co-ordinates";
+
+my @again = $detector->detect( $scene );
+is_deeply \@again, \@faces, "Reusing the cascade gives the same result";
+
+my @ungrouped = $detector->detect( $scene, min_neighbors => 0 );
+cmp_ok 0+@ungrouped, '>', 0+@faces, "Disabling the grouping returns the raw candidates";
+
+my @none = $detector->detect( $scene, size => [200, 200] );
+is 0+@none, 0, "No face is larger than the image";
+
+undef $detector;
+
+my $ok = eval { Image::CCV::BBF->new( cascade => 't/does-not-exist' ); 1 };
+ok !$ok, "Loading a missing cascade dies";
@@ -0,0 +1,54 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 8;
+
+use Image::CCV;
+use Image::CCV::Matrix;
+use Digest::MD5 qw(md5_hex);
+
+my $file = 't/face_IMG_0762_bw_small.png';
+my $png = do {
+    open my $fh, '<', $file or die "Couldn't read '$file': $!";
+    binmode $fh;
+    local $/;
+    <$fh>
+};
+
+is_deeply [ detect_faces( \$png ) ], [ detect_faces( $file ) ],
+    "Encoded image data in memory gives the same faces as the file";
+
+is_deeply [ sift( \$png, \$png ) ], [ sift( $file, $file ) ],
+    "Encoded image data in memory gives the same SIFT matches as the file";
+
+# A blocky test pattern, so that SIFT finds some keypoints
+my ($width, $height) = (64, 48);
+my $gray = join '', map {
+    my $y = $_;
+    map { chr( (($_ >> 3) ^ ($y >> 3)) * 37 % 256 ) } 0..$width-1
+} 0..$height-1;
+(my $rgb = $gray) =~ s/(.)/$1$1$1/sg;
+
+my %gray = ( data => $gray, width => $width, height => $height );
+my %rgb = ( data => $rgb, width => $width, height => $height, format => 'rgb' );
+
+my @gray_matches = sift( \%gray, \%gray );
+cmp_ok 0+@gray_matches, '>', 0, "Raw grayscale pixels get matched";
+is_deeply [ sift( \%rgb, \%rgb ) ], \@gray_matches,
+    "Raw RGB pixels get converted to the same grayscale image";
+
+my %padded = ( %gray, data => join( '', map { substr( $gray, $_ * $width, $width ) . "\0" x 4 } 0..$height-1 ), scanline => $width + 4 );
+is_deeply [ sift( \%padded, \%padded ) ], \@gray_matches,
+    "The scanline of raw pixels is respected";
+
+my $ok = eval { sift( { %gray, height => $height + 1 }, \%gray ); 1 };
+ok !$ok, "Too little pixel data dies";
+
+$ok = eval { sift( \"not an image at all", \%gray ); 1 };
+ok !$ok, "Undecodable image data dies";
+
+# A palette image with a gAMA chunk gets converted to gray in linear
+# light by libpng, the digest is of what libpng makes of it
+is md5_hex( Image::CCV::Matrix->new( 't/palette_gamma.png' )->data ), 'a6df04d02600420dd3659710ddedf31c',
+    "Palette images with a gamma convert to gray like libpng does";
@@ -0,0 +1,49 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 18;
+
+use Image::CCV qw(detect_faces sift get_sift_descriptor);
+
+my $file = 't/face_IMG_0762_bw_small.png';
+
+my $scene = Image::CCV::Matrix->new( $file );
+isa_ok $scene, 'Image::CCV::Matrix';
+is ref $scene->{matrix}, 'ccv_dense_matrix_tPtr', "Matrix class";
+is $scene->cols, 100, "Width";
+is $scene->rows, 150, "Height";
+is( Image::CCV::Matrix->new( $scene ), $scene, "Wrapping a matrix again is a no-op" );
+
+is_deeply [ detect_faces( $scene ) ], [ detect_faces( $file ) ],
+    "A decoded image finds the same faces as the file";
+is_deeply [ sift( $scene, $scene ) ], [ sift( $file, $file ) ],
+    "A decoded image can be reused for several calls";
+
+my $desc = get_sift_descriptor( $scene );
+isa_ok $desc->{keypoints}, 'Image::CCV::Array';
+isa_ok $desc->{descriptor}, 'Image::CCV::Matrix';
+is ref $desc->{keypoints}->{array}, 'ccv_array_tPtr', "Array class";
+is $desc->{descriptor}->rows, $desc->{keypoints}->count, "One descriptor per keypoint";
+is 0+( () = $desc->{keypoints}->points ), $desc->{keypoints}->count, "One point per keypoint";
+
+my $pixels = "\x80" x (32*32);
+my $raw = Image::CCV::Matrix->new({ data => $pixels, width => 32, height => 32 });
+undef $pixels;
+is $raw->cols, 32, "Raw pixels are copied into the matrix";
+
+my $jpeg = 'ccv-src/samples/cmyk-jpeg-format.jpg';
+my $full = Image::CCV::Matrix->new( $jpeg );
+is_deeply [ $full->cols, $full->rows ], [ 2400, 1745 ], "A JPEG without max_dimension is decoded in full";
+my $small = Image::CCV::Matrix->new( $jpeg, max_dimension => 250 );
+is $small->cols, 250, "max_dimension limits the longer side";
+cmp_ok abs( $small->rows - 182 ), '<=', 1, "max_dimension keeps the aspect ratio";
+my $reference = $full->resample( $small->cols, $small->rows );
+my @small = unpack 'C*', $small->data;
+my @reference = unpack 'C*', $reference->data;
+my $diff = 0;
+$diff += abs( $small[$_] - $reference[$_] ) for 0..$#small;
+cmp_ok $diff / @small, '<', 8, "Decoding at a reduced scale looks like shrinking the full image";
+
+my $png = Image::CCV::Matrix->new( $file, max_dimension => 50 );
+is_deeply [ $png->cols, $png->rows ], [ 33, 50 ], "max_dimension shrinks other formats after decoding";
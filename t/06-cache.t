@@ -0,0 +1,28 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 8;
+
+use Image::CCV qw(detect_faces cache_enable cache_drain cache_disable cache_stats);
+
+my $scene = Image::CCV::Matrix->new( 't/face_IMG_0762_bw_small.png' );
+
+my $stats = cache_stats();
+ok $stats->{enabled}, "The cache is enabled on load";
+is $stats->{limit}, 64 * 1024 * 1024, "... with the default size";
+
+my @faces = detect_faces( $scene );
+$stats = cache_stats();
+cmp_ok $stats->{objects}, '>', 0, "The cache survives a detection";
+
+my $hits = $stats->{hits};
+is_deeply [ detect_faces( $scene ) ], \@faces, "Cached results detect the same faces";
+cmp_ok cache_stats()->{hits}, '>', $hits, "Repeated detection recycles cached objects";
+
+cache_drain();
+is cache_stats()->{objects}, 0, "Draining empties the cache";
+
+cache_disable();
+ok !cache_stats()->{enabled}, "The cache can be disabled";
+is_deeply [ detect_faces( $scene ) ], \@faces, "Detection works without a cache";
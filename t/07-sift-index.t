@@ -0,0 +1,33 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 8;
+
+use Image::CCV qw(sift get_sift_descriptor);
+
+my $image = 't/face_IMG_0762_bw_small.png';
+my $features = get_sift_descriptor( $image );
+my $count = $features->{keypoints}->count;
+
+my $index = Image::CCV::SIFT::Index->new( $features );
+isa_ok $index, 'Image::CCV::SIFT::Index';
+isa_ok $index->{index}, 'ccv_sift_index_tPtr', "The kd-forest";
+
+my @exhaustive = $index->match( $features, checks => 0 );
+cmp_ok scalar @exhaustive, '>', $count / 2, "An image matches itself";
+is_deeply [ grep { $_->[0] != $_->[2] or $_->[1] != $_->[3] } @exhaustive ], [],
+    "... keypoint by keypoint";
+
+is_deeply [ $index->match( $features, checks => $count ) ], \@exhaustive,
+    "Checking every descriptor gives the exhaustive result";
+
+my @indexed = $index->match( $features, checks => 16 );
+cmp_ok scalar @indexed, '>=', 0.9 * @exhaustive,
+    "A small number of checks finds most matches";
+
+is_deeply [ sift( $image, $image ) ], \@exhaustive,
+    "sift() gives the same matches";
+
+ok !eval { Image::CCV::SIFT::Index->new( $features, trees => 0 ); 1 },
+    "An index without trees dies";
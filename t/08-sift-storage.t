@@ -0,0 +1,56 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 11;
+use File::Temp qw(tempdir);
+
+use Image::CCV qw(sift get_sift_descriptor write_sift_descriptor read_sift_descriptor);
+
+my $image = 't/face_IMG_0762_bw_small.png';
+my $dir = tempdir( CLEANUP => 1 );
+my $filename = "$dir/face.sift";
+
+my $features = get_sift_descriptor( $image );
+write_sift_descriptor( $features, $filename );
+ok -s $filename, "The features get written";
+
+my $stored = read_sift_descriptor( $filename );
+is $stored->{keypoints}->count, $features->{keypoints}->count, "All keypoints get read back";
+is_deeply [ $stored->{keypoints}->points ], [ $features->{keypoints}->points ], "... unchanged";
+is $stored->{descriptor}->rows, $features->{descriptor}->rows, "All descriptors get read back";
+
+my @matches = sift( $image, $image );
+is_deeply [ sift( $image, $stored ) ], \@matches, "A stored scene matches like the image";
+is_deeply [ sift( $stored, $image ) ], \@matches, "A stored object matches like the image";
+
+my $descriptor = delete $stored->{descriptor};
+undef $stored;
+is_deeply [ sift( $image, { keypoints => $features->{keypoints}, descriptor => $descriptor } ) ], \@matches,
+    "The file stays mapped while the descriptors are in use";
+
+open my $fh, '>', "$dir/broken.sift" or die "$dir/broken.sift: $!";
+print $fh "CCVSIFTD but not really";
+close $fh;
+ok !eval { read_sift_descriptor( "$dir/broken.sift" ); 1 }, "Broken files are rejected";
+like $@, qr/broken\.sift/, "... with the filename in the message";
+
+# Descriptors that are not 128 values of bytes or floats, with a header
+# that is consistent otherwise
+sub patched {
+    my ($name, %field) = @_;
+    open my $in, '<:raw', $filename or die "$filename: $!";
+    my $data = do { local $/; <$in> };
+    my %offset = ( type => 12, cols => 20, step => 28 );
+    substr( $data, $offset{ $_ }, 4 ) = pack 'L', $field{ $_ }
+        for keys %field;
+    open my $out, '>:raw', "$dir/$name" or die "$dir/$name: $!";
+    print $out $data;
+    close $out;
+    "$dir/$name"
+}
+
+ok !eval { read_sift_descriptor( patched( 'short.sift', cols => 64, step => 64 * 4 )); 1 },
+    "Descriptors of other than 128 values are rejected";
+ok !eval { read_sift_descriptor( patched( 'int.sift', type => 0x02001 )); 1 },
+    "Descriptors of other than bytes or floats are rejected";
@@ -0,0 +1,30 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 9;
+use File::Temp qw(tempdir);
+
+use Image::CCV qw(sift get_sift_descriptor write_sift_descriptor read_sift_descriptor);
+
+my $image = 't/face_IMG_0762_bw_small.png';
+my $features = get_sift_descriptor( $image );
+my $quantized = get_sift_descriptor( $image, { quantize => 1 });
+
+is $quantized->{keypoints}->count, $features->{keypoints}->count, "Quantizing keeps all keypoints";
+is $quantized->{descriptor}->rows, $features->{descriptor}->rows, "... and all descriptors";
+
+for my $norm (qw(l2 l1)) {
+    my @matches = sift( $quantized, $quantized, { norm => $norm, checks => 0 });
+    cmp_ok scalar @matches, '>', $features->{keypoints}->count / 2, "An image matches itself ($norm)";
+    is_deeply [ grep { $_->[0] != $_->[2] or $_->[1] != $_->[3] } @matches ], [],
+        "... keypoint by keypoint ($norm)";
+};
+
+ok !eval { sift( $features, $quantized ); 1 }, "Quantized and float descriptors don't mix";
+ok !eval { sift( $image, $image, { norm => 'l1', quantize => 0 }); 1 }, "L1 needs quantized descriptors";
+
+my $dir = tempdir( CLEANUP => 1 );
+write_sift_descriptor( $features, "$dir/float.sift" );
+write_sift_descriptor( $quantized, "$dir/quantized.sift" );
+cmp_ok -s "$dir/quantized.sift", '<', ( -s "$dir/float.sift" ) / 2, "Quantized descriptors are stored compactly";
@@ -0,0 +1,29 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 6;
+use File::Temp qw(tempdir);
+
+use Image::CCV::BBF;
+
+my $scene = 't/face_IMG_0762_bw_small.png';
+my $dir = tempdir( CLEANUP => 1 );
+my $filename = "$dir/face.ccvbbf";
+
+my $detector = Image::CCV::BBF->new();
+ok $detector->save( $filename ), "The cascade gets saved";
+ok -s $filename, "... into a file";
+
+my $mapped = Image::CCV::BBF->new( cascade => $filename );
+isa_ok $mapped, 'Image::CCV::BBF';
+
+is_deeply [ $mapped->detect( $scene, min_neighbors => 0 ) ], [ $detector->detect( $scene, min_neighbors => 0 ) ],
+    "The mapped cascade finds the same candidates";
+is_deeply [ $mapped->detect( $scene ) ], [ $detector->detect( $scene ) ], "... and the same faces";
+
+open my $fh, '>', "$dir/garbage.ccvbbf" or die "$dir/garbage.ccvbbf: $!";
+print $fh "not a cascade" x 10;
+close $fh;
+my $ok = eval { Image::CCV::BBF->new( cascade => "$dir/garbage.ccvbbf" ); 1 };
+ok !$ok, "Loading a file that is no cascade dies";
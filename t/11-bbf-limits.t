@@ -0,0 +1,25 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 6;
+
+use Image::CCV::BBF;
+
+my $scene = 't/face_IMG_0762_bw_small.png';
+
+my $detector = Image::CCV::BBF->new();
+my @faces = $detector->detect( $scene );
+is 0+@faces, 1, "We find one face";
+
+is_deeply [ $detector->detect( $scene, roi => [20, 20, 60, 60] ) ], \@faces,
+    "A region around the face finds it at the same co-ordinates";
+is 0+( my @none = $detector->detect( $scene, roi => [0, 0, 30, 30] ) ), 0,
+    "A region next to the face finds nothing";
+
+is_deeply [ $detector->detect( $scene, min_size => [20, 20], max_size => [40, 40] ) ], \@faces,
+    "A size range around the face finds it";
+is 0+( @none = $detector->detect( $scene, min_size => [60, 60] ) ), 0,
+    "A minimum size above the face finds nothing";
+is 0+( @none = $detector->detect( $scene, max_size => [20, 20] ) ), 0,
+    "A maximum size below the face finds nothing";
@@ -0,0 +1,54 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 11;
+
+use Image::CCV::BBF;
+use Image::CCV::Matrix;
+
+my $scene = Image::CCV::Matrix->new( 't/face_IMG_0762_bw_small.png' );
+my ($width, $height) = ($scene->cols, $scene->rows);
+my $blank = { data => "\0" x ($width * $height), width => $width, height => $height };
+
+my $detector = Image::CCV::BBF->new();
+my @faces = $detector->detect( $scene );
+is 0+@faces, 1, "We find one face";
+
+# A scan of a part of the image samples the scales a little differently,
+# so the face can move by a pixel or two
+sub is_near {
+    my ($got, $expected, $name) = @_;
+    my $near = @$got == @$expected;
+    for my $i (0..$#$expected) {
+        $near &&= abs( $got->[$i][$_] - $expected->[$i][$_] ) <= 2
+            for 0..3;
+    };
+    ok $near, $name
+        or diag "got @{[ map { qq{[@$_]} } @$got ]}";
+}
+
+my $video = $detector->video( interval => 4 );
+is_deeply [ $detector->detect( $scene, video => $video ) ], \@faces,
+    "The first frame is scanned in full";
+is_near [ $detector->detect( $scene, video => $video ) ], \@faces,
+    "Scanning around the face finds it again";
+is 0+( my @none = $detector->detect( $blank, video => $video ) ), 0,
+    "A frame without the face finds nothing";
+is 0+( @none = $detector->detect( $scene, video => $video ) ), 0,
+    "Until the next full scan, nothing is looked for";
+is_deeply [ $detector->detect( $scene, video => $video ) ], \@faces,
+    "The next full scan finds the face again";
+
+$video = $detector->video( interval => 1 );
+is_deeply [ map { $detector->detect( $scene, video => $video ) } 1..3 ], [ (@faces) x 3 ],
+    "An interval of 1 scans every frame in full";
+
+$video = $detector->video( interval => 4, margin => 0 );
+$detector->detect( $scene, video => $video );
+is 0+( @none = $detector->detect( $scene, video => $video ) ), 0,
+    "A margin of 0 is kept, and only looks inside the face found before";
+
+ok !eval { $detector->video( interval => 0 ); 1 }, "An interval below 1 dies";
+ok !eval { $detector->video( scale => 0.5 ); 1 }, "A scale below 1 dies";
+ok !eval { $detector->video( margin => -1 ); 1 }, "A negative margin dies";
@@ -0,0 +1,56 @@
+#!perl -w
+use strict;
+use warnings;
+
+use Test::More tests => 19;
+use Digest::MD5 qw(md5_hex);
+
+use Image::CCV::Matrix;
+
+my $scene = Image::CCV::Matrix->new( 't/face_IMG_0762_bw_small.png' );
+
+# Digests of the output of the plain C loops that ccv_resample() had
+# before it got SSE2 kernels and row bands, which must not change it
+my @expected = (
+    [60, 90, 'area', '0f97400ebe1d5439c2640988f47b38f5'],
+    [33, 50, 'area', 'da050e641575e6a1ed38526a20aa50b7'],
+    [99, 149, 'area', '02f53e83c068cd99c3bfbd78f1d39b32'],
+    [7, 11, 'area', '1e2fb605587f2746474eec3c068f9770'],
+    [160, 240, 'cubic', '3b40161850210e7d5dac7a29b932ce12'],
+    [70, 40, 'cubic', '5ed137ab708a2d5f6193474700ade72f'],
+    [101, 151, 'cubic', 'c792df940de8be711a2c15e8671ee0e0'],
+    [50, 75, 'cubic', '0d4a6b92523bbb8fc21ba25b076b15bc'],
+    [400, 600, 'cubic', 'fbe12d12b12521ac7a8dc8ae6c8585e7'],
+);
+
+for (@expected) {
+    my ($width, $height, $method, $digest) = @$_;
+    my $resampled = $scene->resample( $width, $height, method => $method );
+    is md5_hex( $resampled->data ), $digest, "$method to $width x $height";
+};
+
+# 32-bit integer pixels keep the overshoot of the cubic kernel. The
+# digest is over little-endian values
+my @expected_32s = (
+    [160, 240, '8fcb3141db0111489d8a10977cb8ba88'],
+    [101, 151, '071661e07536ce0b11c54b9d3a1c0209'],
+);
+
+for (@expected_32s) {
+    my ($width, $height, $digest) = @$_;
+    my $resampled = $scene->resample( $width, $height, method => 'cubic', type => '32s' );
+    is md5_hex( pack 'l<*', unpack 'l*', $resampled->data ), $digest, "cubic to $width x $height with 32-bit integers";
+};
+
+my $large = $scene->resample( 600, 900 );
+is $large->cols, 600, "Width";
+is $large->rows, 900, "Height";
+is length( $large->data ), 600 * 900, "One byte per pixel";
+
+# Large enough to be split into several bands of rows
+is md5_hex( $large->resample( 300, 450 )->data ), '3f8089f8f2901130a16d50c240c81583', "area of a large image";
+is md5_hex( $large->resample( 257, 301 )->data ), '68e855df628705ca234e867fe07a25ef', "area of a large image by an odd factor";
+
+ok !eval { $scene->resample( 200, 300, method => 'area' ); 1 }, "area doesn't enlarge";
+ok !eval { $scene->resample( 50, 75, method => 'linear' ); 1 }, "Unknown methods are rejected";
+ok !eval { $scene->resample( 50, 75, type => '16u' ); 1 }, "Unknown types are rejected";